@@ -62,12 +62,12 @@ void ARG::compute_rhos_thetas(double r, double m) {
 }
 
 void ARG::compute_rhos_thetas(Rate_map &rm, Rate_map &mm) {
+    vector<double> recomb_distances = rm.segment_distances(coordinates);
+    vector<double> mut_distances = mm.segment_distances(coordinates);
     int n = (int) coordinates.size() - 1;
     for (int i = 0; i < n; i++) {
-        // rhos.push_back(r*(coordinates[i+1] - coordinates[i]));
-        // thetas.push_back(m*(coordinates[i+1] - coordinates[i]));
-        rhos.push_back(rm.segment_distance(coordinates[i], coordinates[i+1])*Ne);
-        thetas.push_back(mm.segment_distance(coordinates[i], coordinates[i+1])*Ne);
+        rhos.push_back(recomb_distances[i]*Ne);
+        thetas.push_back(mut_distances[i]*Ne);
     }
 }
 
@@ -80,6 +80,7 @@ void ARG::build_singleton_arg(Node_ptr n) {
     for (double x : mutation_sites) {
         mutation_branches[x] = {branch};
     }
+    reset_site_counts();
 }
 
 void ARG::add_sample(Node_ptr n) {
@@ -179,6 +180,30 @@ Tree ARG::internal_modify_tree_to(double x, Tree &reference_tree, double x0) {
     }
 }
 
+Persistent_tree ARG::internal_modify_tree_to(double x, Persistent_tree &reference_tree, double x0) {
+    Persistent_tree tree = reference_tree;
+    if (x == x0) {
+        return tree;
+    } else if (x > x0) {
+        auto recomb_it = recombinations.upper_bound(x0);
+        while (recomb_it->first <= x) {
+            Recombination &r = recomb_it->second;
+            tree.internal_forward_update(r, cut_time);
+            ++recomb_it;
+        }
+        return tree;
+    } else {
+        auto recomb_it = recombinations.upper_bound(x0);
+        --recomb_it;
+        while (recomb_it->first > x) {
+            Recombination &r = recomb_it->second;
+            tree.internal_backward_update(r, cut_time);
+            --recomb_it;
+        }
+        return tree;
+    }
+}
+
 void ARG::remove(tuple<double, Branch, double> cut_point) {
     double pos;
     Branch center_branch;
@@ -232,6 +257,7 @@ void ARG::remove(tuple<double, Branch, double> cut_point) {
     }
     start = removed_branches.begin()->first;
     end = removed_branches.rbegin()->first;
+    mark_dirty(start, end);
     remove_empty_recombinations();
     remap_mutations();
     cut_tree.remove(center_branch, cut_node);
@@ -266,6 +292,7 @@ void ARG::remove(map<double, Branch> seed_branches) {
     }
     removed_branches[end] = next_removed_branch;
     joining_branches[end] = next_joining_branch;
+    mark_dirty(start, end);
     remove_empty_recombinations();
     remap_mutations();
     start = removed_branches.begin()->first;
@@ -302,6 +329,7 @@ double ARG::get_updated_length() {
 }
 
 void ARG::add(map<double, Branch> &new_joining_branches, map<double, Branch> &added_branches) {
+    mark_dirty(start, end);
     auto join_it = new_joining_branches.begin();
     auto add_it = added_branches.begin();
     auto recomb_it = recombinations.lower_bound(start);
@@ -389,36 +417,45 @@ void ARG::adjust_recombinations() {
 
 void ARG::approx_sample_recombinations() {
     // double n = sample_nodes.size();
-    RSP_smc rsp = RSP_smc();
-    auto it = recombinations.upper_bound(0);
-    while (it->first < sequence_length) {
+    // only the breakpoints touched by remove and add since the last clear_remove_info need a new start time
+    vector<Recombination *> recombs = {};
+    auto it = recombinations.lower_bound(dirty_start);
+    while (it->first <= dirty_end and it->first < sequence_length) {
         Recombination &r = it->second;
         if (r.pos > 0 and r.pos < sequence_length) {
-            // rsp.approx_sample_recombination(r, cut_time, n);
-            rsp.approx_sample_recombination(r, cut_time);
-            assert(r.start_time > 0);
-            assert(r.start_time <= r.inserted_node->time);
-            assert(r.start_time <= r.deleted_node->time);
+            recombs.push_back(&r);
         }
         it++;
     }
+    for_each_recombination(recombs, [&](Recombination &r) {
+        RSP_smc rsp = RSP_smc();
+        // rsp.approx_sample_recombination(r, cut_time, n);
+        rsp.approx_sample_recombination(r, cut_time);
+        assert(r.start_time > 0);
+        assert(r.start_time <= r.inserted_node->time);
+        assert(r.start_time <= r.deleted_node->time);
+    });
 }
 
 void ARG::adjust_recombinations() {
     // double n = sample_nodes.size();
-    RSP_smc rsp = RSP_smc();
+    vector<Recombination *> recombs = {};
     auto it = recombinations.upper_bound(0);
     while (it->first < sequence_length) {
         Recombination &r = it->second;
         if (r.pos != 0 and r.pos < sequence_length) {
-            // rsp.adjust(r, 0, n);
-            rsp.adjust(r, 0);
-            assert(r.start_time > 0);
-            assert(r.start_time <= r.inserted_node->time);
-            assert(r.start_time <= r.deleted_node->time);
+            recombs.push_back(&r);
         }
         it++;
     }
+    for_each_recombination(recombs, [&](Recombination &r) {
+        RSP_smc rsp = RSP_smc();
+        // rsp.adjust(r, 0, n);
+        rsp.adjust(r, 0);
+        assert(r.start_time > 0);
+        assert(r.start_time <= r.inserted_node->time);
+        assert(r.start_time <= r.deleted_node->time);
+    });
 }
 
 /*
@@ -449,45 +486,29 @@ int ARG::count_incompatibility() {
  */
 
 int ARG::count_incompatibility() {
-    int count = 0;
-    for (auto &x : mutation_branches) {
-        set<Branch> &branches = x.second;
-        if (branches.size() > 1) {
-            if (branches.rbegin()->upper_node == root) {
-                if (branches.size() > 2) {
-                    count += 1;
-                }
-            } else {
-                if (branches.size() > 1) {
-                    count += 1;
-                }
-            }
-        }
+    if (num_unmapped_sites < 0) {
+        count_sites();
     }
-    return count;
+    return num_unmapped_sites;
 }
 
 
 
 int ARG::count_flipping() {
-    int count = 0;
-    for (auto x : mutation_branches) {
-        set<Branch> &branches = x.second;
-        if (branches.size() > 1 and branches.rbegin()->upper_node == root) {
-            count += 1;
-        }
+    if (num_flippings < 0) {
+        count_sites();
     }
-    return count;
+    return num_flippings;
 }
 
 void ARG::read_coordinates(string filename) {
-    ifstream fin(filename);
-    if (!fin.good()) {
+    Text_reader fin = Text_reader();
+    if (!fin.open(filename)) {
         cerr << "input file not found" << endl;
         exit(1);
     }
     double x;
-    while (fin >> x) {
+    while (fin.read(x)) {
         coordinates.push_back(x);
     }
     // cout << "finished" << endl;
@@ -588,6 +609,13 @@ void ARG::impute(map<double, Branch> &new_joining_branches, map<double, Branch>
             mut_it++;
         }
     }
+    if (num_flippings >= 0 and remapped_start == start and remapped_end == end) {
+        count_sites(start, end, 1);
+        remapped_start = -1;
+        remapped_end = -1;
+    } else {
+        reset_site_counts();
+    }
 }
 
 void ARG::map_mutations(double x, double y) {
@@ -641,6 +669,11 @@ void ARG::map_mutation(double x, Branch joining_branch, Branch added_branch) {
 void ARG::remap_mutations() {
     double x = joining_branches.begin()->first;
     double y = joining_branches.rbegin()->first;
+    if (num_flippings >= 0) {
+        count_sites(x, y, -1);
+        remapped_start = x;
+        remapped_end = y;
+    }
     auto mut_it = mutation_branches.lower_bound(x);
     auto join_it = joining_branches.begin();
     auto remove_it = removed_branches.begin();
@@ -692,6 +725,16 @@ void ARG::map_mutation(Tree tree, double x) {
         }
     }
     mutation_branches[x] = branches;
+    reset_site_counts();
+}
+
+void ARG::map_site(double x) {
+    // a site new to the ARG, the sample states must already be written
+    mutation_sites.insert(x);
+    Tree tree = get_tree_at(x);
+    Fitch_reconstruction rc = Fitch_reconstruction(tree);
+    rc.reconstruct(x);
+    map_mutation(tree, x);
 }
 
 void ARG::check_mapping() {
@@ -726,41 +769,11 @@ void ARG::check_mapping() {
 }
 
 int ARG::num_unmapped() {
-    int count = 0;
-    for (auto &x : mutation_branches) {
-        set<Branch> &branches = x.second;
-        if (branches.size() > 1) {
-            if (branches.rbegin()->upper_node == root) {
-                if (branches.size() > 2) {
-                    count += 1;
-                }
-            } else {
-                if (branches.size() > 1) {
-                    count += 1;
-                }
-            }
-        }
-    }
-    return count;
+    return count_incompatibility();
 }
 
 void ARG::check_incompatibility() {
-    int count = 0;
-    for (auto &x : mutation_branches) {
-        set<Branch> &branches = x.second;
-        if (branches.size() > 1) {
-            if (branches.rbegin()->upper_node == root) {
-                if (branches.size() > 2) {
-                    count += 1;
-                }
-            } else {
-                if (branches.size() > 1) {
-                    count += 1;
-                }
-            }
-        }
-    }
-    cout << "Number of incompatibilities: " << count << endl;
+    cout << "Number of incompatibilities: " << count_incompatibility() << endl;
 }
 
 /*
@@ -790,6 +803,82 @@ void ARG::clear_remove_info() {
     // start = 0;
     // end = 0;
     cut_node = nullptr;
+    dirty_start = INT_MAX;
+    dirty_end = -1;
+}
+
+void ARG::mark_dirty(double x, double y) {
+    dirty_start = min(dirty_start, x);
+    dirty_end = max(dirty_end, y);
+    index_start = min(index_start, x);
+    index_end = max(index_end, y);
+}
+
+void ARG::count_sites() {
+    num_flippings = 0;
+    num_unmapped_sites = 0;
+    for (auto &x : mutation_branches) {
+        set<Branch> &branches = x.second;
+        bool to_root = branches.size() > 0 and branches.rbegin()->upper_node == root;
+        num_flippings += branches.size() > 1 and to_root;
+        num_unmapped_sites += branches.size() > (to_root ? 2 : 1);
+    }
+}
+
+void ARG::count_sites(double x, double y, int sign) {
+    auto it = mutation_branches.lower_bound(x);
+    while (it != mutation_branches.end() and it->first < y) {
+        set<Branch> &branches = it->second;
+        bool to_root = branches.size() > 0 and branches.rbegin()->upper_node == root;
+        num_flippings += sign*(branches.size() > 1 and to_root);
+        num_unmapped_sites += sign*(branches.size() > (to_root ? 2 : 1));
+        it++;
+    }
+}
+
+void ARG::reset_site_counts() {
+    num_flippings = -1;
+    num_unmapped_sites = -1;
+    remapped_start = -1;
+    remapped_end = -1;
+    index_start = 0; // the mappings may have changed anywhere
+    index_end = INT_MAX;
+}
+
+void ARG::update_cut_indexes() {
+    if (index_start > index_end) {
+        return;
+    }
+    if (recomb_index.size() != bin_num + 1 or indexed_sites.size() + 1 != mutation_sites.size()) {
+        // the last bin holds the breakpoints from sequence_length on, the last site is the sentinel at INT_MAX
+        recomb_index = Fenwick_tree(bin_num + 1);
+        indexed_sites = vector<double>(mutation_sites.begin(), prev(mutation_sites.end()));
+        mutation_index = Fenwick_tree((int) indexed_sites.size());
+        index_start = 0;
+        index_end = INT_MAX;
+    }
+    int first = get_index(index_start);
+    int last = index_end >= sequence_length ? bin_num : get_index(index_end);
+    auto recomb_it = recombinations.lower_bound(coordinates[first]);
+    for (int i = first; i <= last; i++) {
+        double bin_end = i < bin_num ? coordinates[i + 1] : INT_MAX;
+        int count = 0;
+        while (recomb_it->first < bin_end) {
+            count += recomb_it->first > 0;
+            recomb_it++;
+        }
+        recomb_index.set(i, count);
+    }
+    auto site_it = lower_bound(indexed_sites.begin(), indexed_sites.end(), index_start);
+    while (site_it != indexed_sites.end() and *site_it <= index_end) {
+        auto mb_it = mutation_branches.find(*site_it);
+        int mapping_size = mb_it == mutation_branches.end() ? 0 : (int) mb_it->second.size();
+        double w = (*site_it < sequence_length and mapping_size > 1) ? mapping_size : 0;
+        mutation_index.set((int) distance(indexed_sites.begin(), site_it), w);
+        site_it++;
+    }
+    index_start = INT_MAX;
+    index_end = -1;
 }
  
 double ARG::smc_prior_likelihood(double r) {
@@ -873,15 +962,87 @@ set<double> ARG::get_check_points() {
         }
         recomb_it++;
     }
-    Node_ptr n;
-    double x;
-    double y;
+    // same test as check_disjoint_nodes, but all spans are traced in one sweep
+    // a lineage waits in active_branches under its current branch and is only touched by the recombinations deleting that branch
+    int num_spans = (int) node_span.size();
+    vector<Branch> lineages = vector<Branch>(num_spans);
+    vector<double> lineage_times = vector<double>(num_spans, 0);
+    vector<bool> active = vector<bool>(num_spans, false);
+    map<double, vector<int>> span_starts = {};
+    map<double, vector<int>> span_ends = {};
+    for (int i = 0; i < num_spans; i++) {
+        span_starts[get<1>(node_span[i])].push_back(i);
+        span_ends[get<2>(node_span[i])].push_back(i);
+    }
     set<double> check_points = {};
-    for (auto ns : node_span) {
-        tie(n, x, y) = ns;
-        if (!check_disjoint_nodes(x, y)) {
-            check_points.insert(y);
+    if (num_spans == 0) {
+        return check_points;
+    }
+    map<Branch, vector<int>> active_branches = {};
+    vector<int> started = {};
+    vector<int> moved = {};
+    double last_pos = span_ends.rbegin()->first;
+    recomb_it = recombinations.lower_bound(span_starts.begin()->first);
+    while (recomb_it->first <= last_pos) {
+        Recombination &r = recomb_it->second;
+        started.clear();
+        auto start_it = span_starts.find(r.pos);
+        if (start_it != span_starts.end()) {
+            for (int i : start_it->second) {
+                lineages[i] = r.merging_branch;
+                lineage_times[i] = r.deleted_node->time;
+                active[i] = true;
+                started.push_back(i);
+            }
+        }
+        auto end_it = span_ends.find(r.pos);
+        if (end_it != span_ends.end()) {
+            for (int i : end_it->second) {
+                if (active[i] and lineages[i] != r.target_branch) {
+                    check_points.insert(r.pos);
+                }
+                active[i] = false;
+            }
+        }
+        moved.clear();
+        if (r.pos == 0 or r.pos == INT_MAX) {
+            for (auto &x : active_branches) {
+                for (int i : x.second) {
+                    if (active[i]) {
+                        check_points.insert(get<2>(node_span[i]));
+                        active[i] = false;
+                    }
+                }
+            }
+            active_branches.clear();
+        } else {
+            for (const Branch &b : r.deleted_branches) {
+                auto branch_it = active_branches.find(b);
+                if (branch_it == active_branches.end()) {
+                    continue;
+                }
+                for (int i : branch_it->second) {
+                    if (active[i]) {
+                        moved.push_back(i);
+                    }
+                }
+                active_branches.erase(branch_it);
+            }
         }
+        moved.insert(moved.end(), started.begin(), started.end());
+        for (int i : moved) {
+            if (!active[i]) {
+                continue;
+            }
+            lineages[i] = r.trace_forward(lineage_times[i], lineages[i]);
+            if (lineages[i] == Branch()) {
+                check_points.insert(get<2>(node_span[i]));
+                active[i] = false;
+            } else {
+                active_branches[lineages[i]].push_back(i);
+            }
+        }
+        recomb_it++;
     }
     return check_points;
 }
@@ -906,6 +1067,42 @@ bool ARG::check_disjoint_nodes(double x, double y) {
 
 // private methods:
 
+void ARG::for_each_recombination(vector<Recombination *> &recombs, const function<void(Recombination &)> &task) {
+    // the start time of a breakpoint only depends on its own branches and no random numbers are drawn,
+    // so the breakpoints can be split into contiguous blocks, one per thread
+    // the only shared write is the shift of an inserted node tied with the deleted node, then the order matters and all run in one thread
+    int num_blocks = min(num_threads, (int) recombs.size()/256);
+    for (Recombination *r : recombs) {
+        if (num_blocks <= 1) {
+            break;
+        }
+        if (r->start_time == 0 and r->deleted_branches.size() > 0 and r->deleted_node->time == r->inserted_node->time) {
+            num_blocks = 1;
+        }
+    }
+    if (num_blocks <= 1) {
+        for (Recombination *r : recombs) {
+            task(*r);
+        }
+        return;
+    }
+    auto run_block = [&](int k) {
+        size_t first = recombs.size()*k/num_blocks;
+        size_t last = recombs.size()*(k + 1)/num_blocks;
+        for (size_t i = first; i < last; i++) {
+            task(*recombs[i]);
+        }
+    };
+    vector<thread> threads = {};
+    for (int k = 1; k < num_blocks; k++) {
+        threads.push_back(thread(run_block, k));
+    }
+    run_block(0);
+    for (thread &t : threads) {
+        t.join();
+    }
+}
+
 void ARG::new_recombination(double pos, Branch prev_added_branch, Branch prev_joining_branch, Branch next_added_branch, Branch next_joining_branch) {
     set<Branch> deleted_branches;
     set<Branch> inserted_branches;
@@ -986,6 +1183,19 @@ void ARG::write_nodes(string filename) {
 }
 
 void ARG::write_branches(string filename) {
+    vector<tuple<double, double, double, double>> branch_info = get_edges();
+    ofstream file;
+    file.open(filename);
+    file << std::setprecision(std::numeric_limits<double>::max_digits10) << std::fixed;
+    for (int i = 0; i < branch_info.size(); i++) {
+        auto [k1, k2, x, l] = branch_info[i];
+        // assert(k1 < 1e5 and k2 < 1e5);
+        file << x << " " << l << " " << k1 << " " << k2 << "\n";
+    }
+    file.close();
+}
+
+vector<tuple<double, double, double, double>> ARG::get_edges() {
     map<Branch, double> branch_map;
     vector<tuple<double, double, double, double>> branch_info;
     double pos;
@@ -1015,15 +1225,7 @@ void ARG::write_branches(string filename) {
         branch_info.push_back({k1, k2, x.second, sequence_length});
     }
     sort(branch_info.begin(), branch_info.end(), compare_edge);
-    ofstream file;
-    file.open(filename);
-    file << std::setprecision(std::numeric_limits<double>::max_digits10) << std::fixed;
-    for (int i = 0; i < branch_info.size(); i++) {
-        auto [k1, k2, x, l] = branch_info[i];
-        // assert(k1 < 1e5 and k2 < 1e5);
-        file << x << " " << l << " " << k1 << " " << k2 << "\n";
-    }
-    file.close();
+    return branch_info;
 }
 
 void ARG::write_recombs(string filename) {
@@ -1053,73 +1255,260 @@ void ARG::write_mutations(string filename) {
     }
 }
 
+void ARG::write_trees(string filename) {
+    Tree_sequence ts = Tree_sequence();
+    ts.add_block(*this, 0);
+    ts.dump(filename);
+}
+
+void ARG::write_checkpoint(vector<char> &buffer) {
+    // every node reachable from a recombination or a mutation is stored, root is -1 and a null node is -2
+    create_node_set();
+    for (auto &x : recombinations) {
+        add_node(x.second.source_branch.lower_node);
+        add_node(x.second.source_branch.upper_node);
+    }
+    for (auto &x : mutation_branches) {
+        for (const Branch &b : x.second) {
+            add_node(b.lower_node);
+            add_node(b.upper_node);
+        }
+    }
+    vector<Node_ptr> nodes = vector<Node_ptr>(node_set.begin(), node_set.end());
+    node_set.clear();
+    unordered_map<Node_ptr, int> node_ids = {{root, -1}, {nullptr, -2}};
+    vector<double> node_times = {};
+    vector<int> node_indices = {};
+    vector<uint64_t> state_offsets = {0};
+    vector<double> state_positions = {};
+    for (int i = 0; i < nodes.size(); i++) {
+        Node_ptr n = nodes[i];
+        node_ids[n] = i;
+        node_times.push_back(n->time);
+        node_indices.push_back(n->index);
+        for (auto &x : n->mutation_sites) {
+            if (x.first >= 0 and x.first < INT_MAX) {
+                state_positions.push_back(x.first);
+            }
+        }
+        state_offsets.push_back(state_positions.size());
+    }
+    vector<double> recomb_positions = {};
+    vector<double> start_times = {};
+    vector<int> recomb_branches = {};
+    for (auto &x : recombinations) {
+        Recombination &r = x.second;
+        recomb_positions.push_back(x.first);
+        start_times.push_back(r.start_time);
+        recomb_branches.push_back(node_ids.at(r.source_branch.lower_node));
+        recomb_branches.push_back(node_ids.at(r.source_branch.upper_node));
+        recomb_branches.push_back((int) r.deleted_branches.size());
+        for (const Branch &b : r.deleted_branches) {
+            recomb_branches.push_back(node_ids.at(b.lower_node));
+            recomb_branches.push_back(node_ids.at(b.upper_node));
+        }
+        recomb_branches.push_back((int) r.inserted_branches.size());
+        for (const Branch &b : r.inserted_branches) {
+            recomb_branches.push_back(node_ids.at(b.lower_node));
+            recomb_branches.push_back(node_ids.at(b.upper_node));
+        }
+    }
+    vector<double> mutation_positions = {};
+    vector<int> mutation_nodes = {};
+    for (auto &x : mutation_branches) {
+        mutation_positions.push_back(x.first);
+        mutation_nodes.push_back((int) x.second.size());
+        for (const Branch &b : x.second) {
+            mutation_nodes.push_back(node_ids.at(b.lower_node));
+            mutation_nodes.push_back(node_ids.at(b.upper_node));
+        }
+    }
+    put_value<double>(buffer, Ne);
+    put_value<double>(buffer, sequence_length);
+    put_value<double>(buffer, bin_size);
+    put_value<double>(buffer, start);
+    put_value<double>(buffer, end);
+    put_vector<double>(buffer, coordinates);
+    put_vector<double>(buffer, rhos);
+    put_vector<double>(buffer, thetas);
+    put_vector<double>(buffer, vector<double>(mutation_sites.begin(), mutation_sites.end()));
+    put_vector<double>(buffer, node_times);
+    put_vector<int>(buffer, node_indices);
+    put_vector<uint64_t>(buffer, state_offsets);
+    put_vector<double>(buffer, state_positions);
+    put_vector<double>(buffer, recomb_positions);
+    put_vector<double>(buffer, start_times);
+    put_vector<int>(buffer, recomb_branches);
+    put_vector<double>(buffer, mutation_positions);
+    put_vector<int>(buffer, mutation_nodes);
+}
+
+void ARG::read_checkpoint(const char *&p) {
+    Ne = get_value<double>(p);
+    sequence_length = get_value<double>(p);
+    bin_size = get_value<double>(p);
+    start = get_value<double>(p);
+    end = get_value<double>(p);
+    coordinates = get_vector<double>(p);
+    rhos = get_vector<double>(p);
+    thetas = get_vector<double>(p);
+    bin_num = (int) coordinates.size() - 1;
+    vector<double> sites = get_vector<double>(p);
+    mutation_sites = set<double>(sites.begin(), sites.end());
+    vector<double> node_times = get_vector<double>(p);
+    vector<int> node_indices = get_vector<int>(p);
+    vector<uint64_t> state_offsets = get_vector<uint64_t>(p);
+    vector<double> state_positions = get_vector<double>(p);
+    vector<Node_ptr> nodes = {};
+    sample_nodes.clear();
+    root->set_index(-1);
+    for (int i = 0; i < node_times.size(); i++) {
+        Node_ptr n = new_node(node_times[i]);
+        n->set_index(node_indices[i]);
+        for (uint64_t j = state_offsets[i]; j < state_offsets[i+1]; j++) {
+            n->write_state(state_positions[j], 1);
+        }
+        if (n->time == 0) {
+            sample_nodes.insert(n);
+        }
+        nodes.push_back(n);
+    }
+    auto get_node = [&](int k) -> Node_ptr {
+        if (k == -1) {
+            return root;
+        } else if (k == -2) {
+            return nullptr;
+        }
+        return nodes[k];
+    };
+    vector<double> recomb_positions = get_vector<double>(p);
+    vector<double> start_times = get_vector<double>(p);
+    vector<int> recomb_branches = get_vector<int>(p);
+    recombinations.clear();
+    size_t k = 0;
+    for (int i = 0; i < recomb_positions.size(); i++) {
+        double pos = recomb_positions[i];
+        Branch source_branch = Branch(get_node(recomb_branches[k]), get_node(recomb_branches[k+1]));
+        k += 2;
+        set<Branch> db = {};
+        set<Branch> ib = {};
+        int num_deleted = recomb_branches[k++];
+        for (int j = 0; j < num_deleted; j++) {
+            db.insert(Branch(get_node(recomb_branches[k]), get_node(recomb_branches[k+1])));
+            k += 2;
+        }
+        int num_inserted = recomb_branches[k++];
+        for (int j = 0; j < num_inserted; j++) {
+            ib.insert(Branch(get_node(recomb_branches[k]), get_node(recomb_branches[k+1])));
+            k += 2;
+        }
+        Recombination r = Recombination(db, ib);
+        r.set_pos(pos);
+        if (pos > 0 and pos < sequence_length) {
+            r.start_time = start_times[i];
+            r.source_branch = source_branch;
+            r.find_nodes();
+            r.find_target_branch();
+            r.find_recomb_info();
+        }
+        recombinations[pos] = r;
+    }
+    vector<double> mutation_positions = get_vector<double>(p);
+    vector<int> mutation_nodes = get_vector<int>(p);
+    mutation_branches.clear();
+    reset_site_counts();
+    k = 0;
+    for (double m : mutation_positions) {
+        set<Branch> &branches = mutation_branches[m];
+        int num_branches = mutation_nodes[k++];
+        for (int j = 0; j < num_branches; j++) {
+            branches.insert(Branch(get_node(mutation_nodes[k]), get_node(mutation_nodes[k+1])));
+            k += 2;
+        }
+    }
+}
+
 void ARG::read_nodes(string filename) {
     root->set_index(-1);
     node_set.clear();
-    ifstream fin(filename);
-    if (!fin.good()) {
+    Text_reader fin = Text_reader();
+    if (!fin.open(filename)) {
         cerr << "input file not found" << endl;
         exit(1);
     }
     double x;
-    while (fin >> x) {
+    while (fin.read(x)) {
         add_new_node(x/Ne);
     }
 }
 
 void ARG::read_branches(string filename) {
-    ifstream fin(filename);
-    if (!fin.good()) {
+    Text_reader fin = Text_reader();
+    if (!fin.open(filename)) {
         cerr << "input file not found" << endl;
         exit(1);
     }
     vector<Node_ptr> nodes = vector<Node_ptr>(node_set.begin(), node_set.end());
-    double x;
-    double y;
-    double p;
-    double c;
-    double left;
-    double right;
-    Node_ptr parent_node;
-    Node_ptr child_node;
-    Branch b;
-    map<double, set<Branch>> deleted_branches = {{0, {}}};
-    map<double, set<Branch>> inserted_branches = {};
-    while (fin >> x >> y >> p >> c) {
-        left = x;
-        right = y;
-        if (p < 0) {
-            parent_node = root;
-        } else {
-            parent_node = nodes[int(p)];
+    // edges are kept as (position, parent rank, child rank) with ranks in node_set order, so sorting them gives the order of set<Branch>
+    int root_rank = (int) nodes.size();
+    auto run_tasks = [&](int num_tasks, auto task) {
+        vector<thread> threads = {};
+        for (int i = 1; i < num_tasks; i++) {
+            if (num_threads > 1) {
+                threads.push_back(thread(task, i));
+            } else {
+                task(i);
+            }
         }
-        child_node = nodes[int(c)];
-        b = Branch(child_node, parent_node);
-        if (deleted_branches.count(right) > 0) {
-            deleted_branches[right].insert(b);
-        } else {
-            deleted_branches[right] = {b};
+        if (num_tasks > 0) {
+            task(0);
         }
-        if (inserted_branches.count(left) > 0) {
-            inserted_branches[left].insert(b);
-        } else {
-            inserted_branches[left] = {b};
+        for (thread &t : threads) {
+            t.join();
         }
-    }
+    };
+    vector<Text_reader> chunks = fin.split(num_threads);
+    vector<vector<tuple<double, int, int>>> chunk_keys[2] = {vector<vector<tuple<double, int, int>>>(chunks.size()), vector<vector<tuple<double, int, int>>>(chunks.size())};
+    run_tasks((int) chunks.size(), [&](int i) {
+        double x, y, p, c;
+        while (chunks[i].read(x) and chunks[i].read(y) and chunks[i].read(p) and chunks[i].read(c)) {
+            int parent_rank = p < 0 ? root_rank : int(p);
+            chunk_keys[0][i].push_back({y, parent_rank, int(c)});
+            chunk_keys[1][i].push_back({x, parent_rank, int(c)});
+        }
+    });
+    // deleted branches by right end and inserted branches by left end, each set built by appending at its end
+    map<double, set<Branch>> groups[2] = {{{0, {}}}, {}};
+    run_tasks(2, [&](int k) {
+        vector<tuple<double, int, int>> keys = {};
+        for (auto &v : chunk_keys[k]) {
+            keys.insert(keys.end(), v.begin(), v.end());
+            v = {};
+        }
+        sort(keys.begin(), keys.end());
+        auto it = groups[k].end();
+        for (auto &[x, p, c] : keys) {
+            if (it == groups[k].end() or it->first != x) {
+                it = groups[k].emplace_hint(groups[k].end(), x, set<Branch>());
+            }
+            it->second.emplace_hint(it->second.end(), nodes[c], p == root_rank ? root : nodes[p]);
+        }
+    });
+    map<double, set<Branch>> &deleted_branches = groups[0];
+    map<double, set<Branch>> &inserted_branches = groups[1];
     deleted_branches.erase(sequence_length);
-    for (auto x : deleted_branches) {
+    auto hint = recombinations.begin();
+    for (auto &x : deleted_branches) {
         double pos = x.first;
-        set<Branch> db = deleted_branches.at(pos);
-        set<Branch> ib = inserted_branches.at(pos);
-        Recombination r = Recombination(db, ib);
+        Recombination r = Recombination(move(x.second), move(inserted_branches.at(pos)));
         r.set_pos(pos);
-        recombinations[pos] = r;
+        hint = recombinations.insert_or_assign(hint, pos, move(r));
     }
 }
 
 void ARG::read_recombs(string filename) {
-    ifstream fin(filename);
-    if (!fin.good()) {
+    Text_reader fin = Text_reader();
+    if (!fin.open(filename)) {
         cerr << "input file not found" << endl;
         exit(1);
     }
@@ -1134,7 +1523,7 @@ void ARG::read_recombs(string filename) {
     Node_ptr ln;
     Node_ptr un;
     Branch b;
-    while (fin >> pos >> n1 >> n2 >> t) {
+    while (fin.read(pos) and fin.read(n1) and fin.read(n2) and fin.read(t)) {
         ln = nodes[n1];
         if (n2 == -1) {
             un = root;
@@ -1167,8 +1556,8 @@ void ARG::read_recombs(string filename) {
 }
 
 void ARG::read_muts(string filename) {
-    ifstream fin(filename);
-    if (!fin.good()) {
+    Text_reader fin = Text_reader();
+    if (!fin.open(filename)) {
         cerr << "input file not found" << endl;
         exit(1);
     }
@@ -1181,7 +1570,7 @@ void ARG::read_muts(string filename) {
     Node_ptr ln;
     Node_ptr un;
     Branch b;
-    while (fin >> pos >> n1 >> n2 >> s) {
+    while (fin.read(pos) and fin.read(n1) and fin.read(n2) and fin.read(s)) {
         if (pos <= sequence_length) {
             mutation_sites.insert(pos);
             ln = nodes[n1];
@@ -1201,6 +1590,7 @@ void ARG::read_muts(string filename) {
             mutation_branches[pos].insert(b);
         }
     }
+    reset_site_counts();
     Tree tree = Tree();
     auto m_it = mutation_branches.begin();
     auto r_it = recombinations.begin();
@@ -1335,6 +1725,26 @@ tuple<double, Branch, double> ARG::sample_internal_cut() {
     return {cut_pos, b, t};
 }
 
+tuple<double, Branch, double> ARG::sample_internal_cut(double x) {
+    // the tree at x is moved from the end of the last update when possible, except when that update reached the end of the sequence
+    bool from_end = end < sequence_length - 0.1 and end_tree.parents.size() > 0;
+    if (from_end and x == end) {
+        cut_tree = move(end_tree);
+    } else if (from_end and abs(x - end) < x) {
+        cut_tree = modify_tree_to(x, end_tree, end);
+    } else {
+        cut_tree = get_tree_at(x);
+    }
+    cut_pos = x;
+    Branch b;
+    double t;
+    tie(b, t) = cut_tree.sample_cut_point();
+    while (t == b.lower_node->time or t == b.upper_node->time) {
+        tie(b, t) = cut_tree.sample_cut_point();
+    }
+    return {cut_pos, b, t};
+}
+
 /*
 tuple<double, Branch, double> ARG::sample_internal_cut() {
     if (end >= sequence_length) {
@@ -1352,11 +1762,18 @@ tuple<double, Branch, double> ARG::sample_internal_cut() {
  */
 
 tuple<double, Branch, double> ARG::sample_recombination_cut() {
-    auto recomb_it = recombinations.begin();
+    update_cut_indexes();
+    assert(recomb_index.total() == recombinations.size() - 2);
     double p = uniform_random();
     int dist = (recombinations.size() - 2)*p;
     dist = max(dist, 1);
-    advance(recomb_it, dist);
+    // the breakpoint dist after the one at 0, found by its bin and then by its rank in the bin
+    int i = recomb_index.find(dist - 1);
+    auto recomb_it = recombinations.lower_bound(coordinates[i]);
+    if (recomb_it->first == 0) {
+        recomb_it++;
+    }
+    advance(recomb_it, dist - 1 - (int) recomb_index.prefix(i));
     Recombination &r = recomb_it->second;
     assert(r.pos > 0 and r.pos < sequence_length);
     double x = r.pos + 1;
@@ -1367,29 +1784,18 @@ tuple<double, Branch, double> ARG::sample_recombination_cut() {
 }
 
 tuple<double, Branch, double> ARG::sample_mutation_cut() {
-    double p = 0;
-    double replace_prob = 0;
-    int mapping_size = 0;
-    int count = 0;
-    auto mb_it = mutation_branches.begin();
+    update_cut_indexes();
     Branch b;
     double x = 0, t = 0;
-    while (mb_it->first < sequence_length) {
-        mapping_size = (int) mb_it->second.size();
-        replace_prob = 0;
-        if (mapping_size > 1) {
-            replace_prob = (double) mapping_size/(mapping_size + count);
-            count += mb_it->second.size();
-        }
-        p = uniform_random();
-        if (p < replace_prob) {
-            auto b_it = mb_it->second.begin();
-            advance(b_it, (mapping_size - 1)*uniform_random());
-            b = *b_it;
-            x = mb_it->first;
-            t = b.lower_node->time + 1e-3;
-        }
-        mb_it++;
+    // a site mapped to more than one branch is chosen with probability proportional to the number of its branches
+    if (mutation_index.total() > 0) {
+        int k = mutation_index.find(uniform_random()*mutation_index.total());
+        x = indexed_sites[k];
+        set<Branch> &branches = mutation_branches[x];
+        auto b_it = branches.begin();
+        advance(b_it, (branches.size() - 1)*uniform_random());
+        b = *b_it;
+        t = b.lower_node->time + 1e-3;
     }
     cut_pos = x;
     cut_tree = get_tree_at(x);
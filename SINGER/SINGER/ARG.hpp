@@ -10,12 +10,20 @@
 
 #include <stdio.h>
 #include <map>
+#include <array>
+#include <thread>
+#include <functional>
 #include "Recombination.hpp"
 #include "Tree.hpp"
+#include "Persistent_tree.hpp"
+#include "Fenwick_tree.hpp"
 #include "RSP_smc.hpp"
 #include "Reconstruction.hpp"
 #include "Fitch_reconstruction.hpp"
 #include "Rate_map.hpp"
+#include "Tree_sequence.hpp"
+#include "Checkpoint.hpp"
+#include "Text_reader.hpp"
 
 class ARG {
     
@@ -43,6 +51,18 @@ public:
     double start = 0;
     double end = 0;
     double cut_pos = 0;
+    int num_threads = 1;
+    double dirty_start = 0; // span of breakpoints changed by remove and add since the last clear_remove_info
+    double dirty_end = INT_MAX;
+    int num_flippings = -1; // site counts kept up to date by remove and add, -1 when they have to be counted again
+    int num_unmapped_sites = -1;
+    double remapped_start = -1; // sites taken out of the counts by remove, put back by the following add
+    double remapped_end = -1;
+    Fenwick_tree recomb_index = Fenwick_tree(); // breakpoints in each bin other than the first and the last one, for sample_recombination_cut
+    Fenwick_tree mutation_index = Fenwick_tree(); // weight of each site in sample_mutation_cut
+    vector<double> indexed_sites = {};
+    double index_start = 0; // span where the two indexes are out of date
+    double index_end = INT_MAX;
     Tree cut_tree;
     Tree start_tree;
     Tree end_tree;
@@ -76,6 +96,8 @@ public:
     Tree modify_tree_to(double x, Tree &reference_tree, double x0);
     
     Tree internal_modify_tree_to(double x, Tree &reference_tree, double x0);
+    
+    Persistent_tree internal_modify_tree_to(double x, Persistent_tree &reference_tree, double x0);
 
     void remove(tuple<double, Branch, double> cut_point);
     
@@ -107,6 +129,12 @@ public:
     
     void write(string node_file, string branch_file, string recomb_file, string mutation_file);
     
+    void write_trees(string filename);
+    
+    void write_checkpoint(vector<char> &buffer);
+    
+    void read_checkpoint(const char *&p);
+    
     void read(string node_file, string branch_file);
     
     void read(string node_file, string branch_file, string recomb_file);
@@ -121,6 +149,8 @@ public:
     
     tuple<double, Branch, double> sample_internal_cut();
     
+    tuple<double, Branch, double> sample_internal_cut(double x); // at a given position
+    
     tuple<double, Branch, double> sample_terminal_cut();
     
     tuple<double, Branch, double> sample_recombination_cut();
@@ -138,6 +168,8 @@ public:
     void map_mutation(double x, Branch joining_branch, Branch added_branch);
     
     void map_mutation(Tree tree, double x);
+    
+    void map_site(double x);
 
     void check_mapping();
     
@@ -147,6 +179,16 @@ public:
     
     void clear_remove_info();
     
+    void mark_dirty(double x, double y);
+    
+    void count_sites();
+    
+    void count_sites(double x, double y, int sign);
+    
+    void reset_site_counts();
+    
+    void update_cut_indexes();
+    
     double smc_prior_likelihood(double r);
     
     double data_likelihood(double m);
@@ -161,6 +203,8 @@ public:
     
     double random();
     
+    void for_each_recombination(vector<Recombination *> &recombs, const function<void(Recombination &)> &task);
+    
     void new_recombination(double pos, Branch prev_added_branch, Branch prev_joining_branch, Branch next_added_branch, Branch next_joining_branch);
     
     void remove_empty_recombinations();
@@ -173,6 +217,8 @@ public:
     
     void write_branches(string filename);
     
+    vector<tuple<double, double, double, double>> get_edges();
+    
     void write_recombs(string filename);
     
     void write_mutations(string filename);
@@ -0,0 +1,403 @@
+//
+//  ARG_archive.cpp
+//  SINGER
+//
+
+#include "ARG_archive.hpp"
+
+static const char archive_magic[8] = {'S', 'I', 'N', 'G', 'E', 'R', 'A', 'R'};
+static const uint32_t archive_version = 1;
+static const size_t archive_header_size = 28;
+static const size_t record_header_size = 13;
+
+ARG_archive::ARG_archive() {}
+
+void ARG_archive::open_write(string filename, double N, double l, bool append) {
+    Ne = N;
+    sequence_length = l;
+    uint64_t complete_size = 0;
+    ifstream existing(filename, ios::in|ios::binary|ios::ate);
+    if (append and existing.is_open() and (uint64_t) existing.tellg() >= archive_header_size) {
+        uint64_t file_size = existing.tellg();
+        existing.seekg(0);
+        double existing_Ne = 0;
+        double existing_length = 0;
+        if (!read_header(existing, existing_Ne, existing_length) or existing_Ne != Ne or existing_length != sequence_length) {
+            cerr << "not a compatible archive file: " << filename << endl;
+            exit(1);
+        }
+        // a record cut short by an interrupted run is cut off, otherwise the records appended now would be read as its end
+        complete_size = read_index(existing, file_size);
+        sample_indices.clear();
+        keyframes.clear();
+        record_offsets.clear();
+        record_sizes.clear();
+    }
+    existing.close();
+    if (complete_size > 0) {
+        if (truncate(filename.c_str(), complete_size) != 0) {
+            cerr << "Error writing the file: " << filename << endl;
+            exit(1);
+        }
+        out_file.open(filename, ios::out|ios::binary|ios::app);
+    } else {
+        out_file.open(filename, ios::out|ios::binary|ios::trunc);
+    }
+    if (!out_file) {
+        cerr << "Error opening the file: " << filename << endl;
+        exit(1);
+    }
+    if (complete_size == 0) {
+        out_file.write(archive_magic, 8);
+        out_file.write((const char *) &archive_version, 4);
+        out_file.write((const char *) &Ne, 8);
+        out_file.write((const char *) &sequence_length, 8);
+    }
+    // the node ids of an earlier run are not known, so the first record is always a keyframe
+    num_written = 0;
+    clear();
+}
+
+bool ARG_archive::is_open() {
+    return out_file.is_open();
+}
+
+void ARG_archive::add_sample(ARG &a, int index) {
+    bool keyframe = num_written % keyframe_interval == 0;
+    if (keyframe) {
+        clear();
+    }
+    // same node indices as ARG::write_nodes
+    a.create_node_set();
+    vector<Node_ptr> nodes = vector<Node_ptr>(a.node_set.begin(), a.node_set.end());
+    a.node_set.clear();
+    for (int i = 0; i < nodes.size(); i++) {
+        if (nodes[i]->time > 0) {
+            nodes[i]->set_index(i);
+        }
+    }
+    unordered_set<Node_ptr> alive = unordered_set<Node_ptr>(nodes.begin(), nodes.end());
+    vector<int> removed_ids = {};
+    for (auto it = node_ids.begin(); it != node_ids.end();) {
+        if (alive.count(it->first) == 0) {
+            removed_ids.push_back(it->second);
+            node_times.erase(it->second);
+            it = node_ids.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    sort(removed_ids.begin(), removed_ids.end());
+    int first_new_id = next_id;
+    unordered_map<int, int> id_of_index = {{-1, -1}};
+    for (Node_ptr n : nodes) {
+        if (node_ids.count(n) == 0) {
+            node_ids[n] = next_id;
+            next_id += 1;
+        }
+        id_of_index[n->index] = node_ids[n];
+        node_times[node_ids[n]] = n->time;
+    }
+    vector<double> times = {};
+    for (auto &x : node_times) {
+        times.push_back(x.second);
+    }
+    set<tuple<int, int, double, double>> new_edges = {};
+    for (auto [k1, k2, x, y] : a.get_edges()) {
+        new_edges.insert({id_of_index.at(k1), id_of_index.at(k2), x, y});
+    }
+    map<double, tuple<int, int, double>> new_recombs = {};
+    for (auto &x : a.recombinations) {
+        Recombination &r = x.second;
+        if (x.first > 0 and x.first < a.sequence_length) {
+            new_recombs[x.first] = {id_of_index.at(r.source_branch.lower_node->index), id_of_index.at(r.source_branch.upper_node->index), r.start_time};
+        }
+    }
+    set<tuple<double, int, int, int>> new_mutations = {};
+    for (auto &x : a.mutation_branches) {
+        double m = x.first;
+        if (m > 0 and m < a.sequence_length) {
+            for (const Branch &b : x.second) {
+                new_mutations.insert({m, id_of_index.at(b.lower_node->index), id_of_index.at(b.upper_node->index), (int) b.lower_node->get_state(m)});
+            }
+        }
+    }
+    vector<int> edge_nodes[2] = {};
+    vector<double> edge_spans[2] = {};
+    for (int k = 0; k < 2; k++) {
+        const set<tuple<int, int, double, double>> &from = k == 0 ? edges : new_edges;
+        const set<tuple<int, int, double, double>> &to = k == 0 ? new_edges : edges;
+        for (auto &e : from) {
+            if (to.count(e) == 0) {
+                edge_nodes[k].push_back(get<0>(e));
+                edge_nodes[k].push_back(get<1>(e));
+                edge_spans[k].push_back(get<2>(e));
+                edge_spans[k].push_back(get<3>(e));
+            }
+        }
+    }
+    vector<double> removed_recombs = {};
+    vector<double> added_recombs = {};
+    vector<int> added_sources = {};
+    vector<double> start_times = {};
+    for (auto &x : recombs) {
+        auto it = new_recombs.find(x.first);
+        if (it == new_recombs.end() or get<0>(it->second) != get<0>(x.second) or get<1>(it->second) != get<1>(x.second)) {
+            removed_recombs.push_back(x.first);
+        }
+    }
+    for (auto &x : new_recombs) {
+        auto it = recombs.find(x.first);
+        if (it == recombs.end() or get<0>(it->second) != get<0>(x.second) or get<1>(it->second) != get<1>(x.second)) {
+            added_recombs.push_back(x.first);
+            added_sources.push_back(get<0>(x.second));
+            added_sources.push_back(get<1>(x.second));
+        }
+        start_times.push_back(get<2>(x.second)); // rescaling moves every start time, so these are always stored in full
+    }
+    vector<double> mutation_positions[2] = {};
+    vector<int> mutation_nodes[2] = {};
+    for (int k = 0; k < 2; k++) {
+        const set<tuple<double, int, int, int>> &from = k == 0 ? mutations : new_mutations;
+        const set<tuple<double, int, int, int>> &to = k == 0 ? new_mutations : mutations;
+        for (auto &x : from) {
+            if (to.count(x) == 0) {
+                mutation_positions[k].push_back(get<0>(x));
+                mutation_nodes[k].push_back(get<1>(x));
+                mutation_nodes[k].push_back(get<2>(x));
+                mutation_nodes[k].push_back(get<3>(x));
+            }
+        }
+    }
+    edges = move(new_edges);
+    recombs = move(new_recombs);
+    mutations = move(new_mutations);
+    vector<char> buffer = {};
+    put_value<int>(buffer, first_new_id);
+    put_value<int>(buffer, next_id - first_new_id);
+    put_vector<int>(buffer, removed_ids);
+    put_vector<double>(buffer, times);
+    for (int k = 0; k < 2; k++) {
+        put_vector<int>(buffer, edge_nodes[k]);
+        put_vector<double>(buffer, edge_spans[k]);
+    }
+    put_vector<double>(buffer, removed_recombs);
+    put_vector<double>(buffer, added_recombs);
+    put_vector<int>(buffer, added_sources);
+    put_vector<double>(buffer, start_times);
+    for (int k = 0; k < 2; k++) {
+        put_vector<double>(buffer, mutation_positions[k]);
+        put_vector<int>(buffer, mutation_nodes[k]);
+    }
+    int32_t sample_index = index;
+    uint8_t flag = keyframe;
+    uint64_t size = buffer.size();
+    out_file.write((const char *) &sample_index, 4);
+    out_file.write((const char *) &flag, 1);
+    out_file.write((const char *) &size, 8);
+    out_file.write(buffer.data(), buffer.size());
+    out_file.flush();
+    num_written += 1;
+}
+
+bool ARG_archive::open(string filename) {
+    in_file.open(filename, ios::in|ios::binary);
+    if (!in_file.is_open()) {
+        return false;
+    }
+    in_file.seekg(0, ios::end);
+    uint64_t file_size = in_file.tellg();
+    in_file.seekg(0);
+    if (!read_header(in_file, Ne, sequence_length)) {
+        cerr << "not a compatible archive file: " << filename << endl;
+        return false;
+    }
+    // a record cut short by an interrupted run is ignored
+    read_index(in_file, file_size);
+    current_record = -1;
+    return true;
+}
+
+bool ARG_archive::read_sample(int index) {
+    // a resumed run may write the same sample twice, the last record is the one that was kept
+    int last = -1;
+    for (int i = 0; i < sample_indices.size(); i++) {
+        if (sample_indices[i] == index) {
+            last = i;
+        }
+    }
+    if (last < 0) {
+        return false;
+    }
+    int first = last;
+    while (!keyframes[first]) {
+        first -= 1;
+    }
+    if (current_record >= first and current_record <= last) {
+        first = current_record + 1;
+    } else {
+        clear();
+    }
+    vector<char> buffer = {};
+    for (int i = first; i <= last; i++) {
+        buffer.resize(record_sizes[i]);
+        in_file.clear();
+        in_file.seekg(record_offsets[i]);
+        in_file.read(buffer.data(), buffer.size());
+        apply_record(buffer.data());
+        current_record = i;
+    }
+    return true;
+}
+
+void ARG_archive::write_sample(string node_file, string branch_file, string recomb_file, string mutation_file) {
+    // nodes are ordered by time as in ARG::write_nodes, samples have the lowest ids
+    vector<pair<double, int>> ordered_nodes = {};
+    for (auto &x : node_times) {
+        ordered_nodes.push_back({x.second, x.first});
+    }
+    sort(ordered_nodes.begin(), ordered_nodes.end());
+    unordered_map<int, int> index_of_id = {{-1, -1}};
+    unordered_map<int, double> time_of_id = {{-1, numeric_limits<double>::infinity()}};
+    for (int i = 0; i < ordered_nodes.size(); i++) {
+        index_of_id[ordered_nodes[i].second] = i;
+        time_of_id[ordered_nodes[i].second] = ordered_nodes[i].first;
+    }
+    ofstream node_out;
+    node_out.open(node_file);
+    for (auto &x : ordered_nodes) {
+        node_out << std::setprecision(std::numeric_limits<double>::max_digits10) << x.first*Ne << "\n";
+    }
+    node_out.close();
+    vector<tuple<double, double, double, double>> branch_info = {};
+    for (auto &e : edges) {
+        branch_info.push_back({index_of_id.at(get<0>(e)), index_of_id.at(get<1>(e)), get<2>(e), get<3>(e)});
+    }
+    sort(branch_info.begin(), branch_info.end(), compare_edge);
+    ofstream branch_out;
+    branch_out.open(branch_file);
+    branch_out << std::setprecision(std::numeric_limits<double>::max_digits10) << std::fixed;
+    for (auto [k1, k2, x, l] : branch_info) {
+        branch_out << x << " " << l << " " << k1 << " " << k2 << "\n";
+    }
+    branch_out.close();
+    ofstream recomb_out;
+    recomb_out.open(recomb_file);
+    recomb_out << std::setprecision(std::numeric_limits<double>::max_digits10) << std::fixed;
+    for (auto &x : recombs) {
+        recomb_out << x.first << " " << index_of_id.at(get<0>(x.second)) << " " << index_of_id.at(get<1>(x.second)) << " " << Ne*get<2>(x.second) << endl;
+    }
+    recomb_out.close();
+    ofstream mutation_out;
+    mutation_out.open(mutation_file);
+    mutation_out.precision(numeric_limits<double>::max_digits10);
+    // branches at a site in the order of set<Branch>: upper node first, nodes compared by time then index
+    vector<tuple<double, double, int, double, int, int>> mutation_info = {};
+    for (auto &x : mutations) {
+        int l = get<1>(x);
+        int u = get<2>(x);
+        mutation_info.push_back({get<0>(x), time_of_id.at(u), index_of_id.at(u), time_of_id.at(l), index_of_id.at(l), get<3>(x)});
+    }
+    sort(mutation_info.begin(), mutation_info.end());
+    for (auto [m, ut, u, lt, l, s] : mutation_info) {
+        mutation_out << m << " " << l << " " << u << " " << (double) s << endl;
+    }
+    mutation_out.close();
+}
+
+// private methods:
+
+void ARG_archive::clear() {
+    node_ids.clear();
+    next_id = 0;
+    node_times.clear();
+    edges.clear();
+    recombs.clear();
+    mutations.clear();
+}
+
+void ARG_archive::apply_record(const char *p) {
+    int first_new_id = get_value<int>(p);
+    int num_new = get_value<int>(p);
+    for (int id : get_vector<int>(p)) {
+        node_times.erase(id);
+    }
+    for (int id = first_new_id; id < first_new_id + num_new; id++) {
+        node_times[id] = 0;
+    }
+    vector<double> times = get_vector<double>(p);
+    int i = 0;
+    for (auto &x : node_times) {
+        x.second = times[i++];
+    }
+    for (int k = 0; k < 2; k++) {
+        vector<int> edge_nodes = get_vector<int>(p);
+        vector<double> edge_spans = get_vector<double>(p);
+        for (int j = 0; j < edge_nodes.size(); j += 2) {
+            tuple<int, int, double, double> e = {edge_nodes[j], edge_nodes[j+1], edge_spans[j], edge_spans[j+1]};
+            if (k == 0) {
+                edges.erase(e);
+            } else {
+                edges.insert(e);
+            }
+        }
+    }
+    for (double x : get_vector<double>(p)) {
+        recombs.erase(x);
+    }
+    vector<double> added_recombs = get_vector<double>(p);
+    vector<int> added_sources = get_vector<int>(p);
+    for (int j = 0; j < added_recombs.size(); j++) {
+        recombs[added_recombs[j]] = {added_sources[2*j], added_sources[2*j+1], -1};
+    }
+    vector<double> start_times = get_vector<double>(p);
+    i = 0;
+    for (auto &x : recombs) {
+        get<2>(x.second) = start_times[i++];
+    }
+    for (int k = 0; k < 2; k++) {
+        vector<double> mutation_positions = get_vector<double>(p);
+        vector<int> mutation_nodes = get_vector<int>(p);
+        for (int j = 0; j < mutation_positions.size(); j++) {
+            tuple<double, int, int, int> x = {mutation_positions[j], mutation_nodes[3*j], mutation_nodes[3*j+1], mutation_nodes[3*j+2]};
+            if (k == 0) {
+                mutations.erase(x);
+            } else {
+                mutations.insert(x);
+            }
+        }
+    }
+}
+
+bool ARG_archive::read_header(ifstream &file, double &N, double &l) {
+    char magic[8];
+    uint32_t version = 0;
+    file.read(magic, 8);
+    file.read((char *) &version, 4);
+    file.read((char *) &N, 8);
+    file.read((char *) &l, 8);
+    return file and memcmp(magic, archive_magic, 8) == 0 and version == archive_version;
+}
+
+uint64_t ARG_archive::read_index(ifstream &file, uint64_t file_size) {
+    // returns the end of the last complete record
+    uint64_t offset = archive_header_size;
+    while (offset + record_header_size <= file_size) {
+        int32_t sample_index;
+        uint8_t flag;
+        uint64_t size;
+        file.read((char *) &sample_index, 4);
+        file.read((char *) &flag, 1);
+        file.read((char *) &size, 8);
+        if (offset + record_header_size + size > file_size) {
+            break;
+        }
+        sample_indices.push_back(sample_index);
+        keyframes.push_back(flag);
+        record_offsets.push_back(offset + record_header_size);
+        record_sizes.push_back(size);
+        offset += record_header_size + size;
+        file.seekg(offset);
+    }
+    return offset;
+}
@@ -0,0 +1,67 @@
+//
+//  ARG_archive.hpp
+//  SINGER
+//
+
+#ifndef ARG_archive_hpp
+#define ARG_archive_hpp
+
+#include <stdio.h>
+#include <iomanip>
+#include <unistd.h>
+#include "ARG.hpp"
+#include "Checkpoint.hpp"
+
+// all samples of a chain in one file: a record holds the changes since the previous record, every keyframe_interval-th record is a full copy
+// nodes get ids that stay fixed while the node is alive, so edges, recombinations and mutations outside the rethreaded spans are not repeated
+class ARG_archive {
+
+public:
+
+    int keyframe_interval = 10;
+    double Ne = 1;
+    double sequence_length = 0;
+    vector<int> sample_indices = {}; // sample index of each record
+    vector<bool> keyframes = {};
+
+    // state of the last written or read record, nodes by id
+    map<int, double> node_times = {};
+    set<tuple<int, int, double, double>> edges = {}; // parent, child, left, right
+    map<double, tuple<int, int, double>> recombs = {}; // source lower, source upper, start time
+    set<tuple<double, int, int, int>> mutations = {}; // position, lower, upper, state of lower
+
+    ARG_archive();
+
+    void open_write(string filename, double N, double l, bool append);
+
+    bool is_open();
+
+    void add_sample(ARG &a, int index);
+
+    bool open(string filename);
+
+    bool read_sample(int index);
+
+    void write_sample(string node_file, string branch_file, string recomb_file, string mutation_file);
+
+private:
+
+    ofstream out_file;
+    ifstream in_file;
+    int num_written = 0;
+    int next_id = 0;
+    int current_record = -1;
+    unordered_map<Node_ptr, int> node_ids = {};
+    vector<uint64_t> record_offsets = {};
+    vector<uint64_t> record_sizes = {};
+
+    void clear();
+
+    void apply_record(const char *p);
+
+    bool read_header(ifstream &file, double &N, double &l);
+
+    uint64_t read_index(ifstream &file, uint64_t file_size);
+};
+
+#endif /* ARG_archive_hpp */
@@ -0,0 +1,6 @@
+//
+//  Accumulator.cpp
+//  SINGER
+//
+
+#include "Accumulator.hpp"
@@ -0,0 +1,40 @@
+//
+//  Accumulator.hpp
+//  SINGER
+//
+
+#ifndef Accumulator_hpp
+#define Accumulator_hpp
+
+#include <stdio.h>
+#include "ARG.hpp"
+#include "Checkpoint.hpp"
+
+// posterior summary updated with every sample, so that the samples themselves don't have to be kept
+class Accumulator {
+
+public:
+
+    int num_samples = 0;
+
+    virtual ~Accumulator() {}
+
+    virtual string name() = 0;
+
+    virtual void update(ARG &a) = 0;
+
+    virtual void write(string prefix) = 0; // output files are prefix_<name>...
+
+    virtual void write_state(vector<char> &buffer) = 0;
+
+    virtual void read_state(const char *&p) = 0;
+};
+
+// Welford's update of a running mean and sum of squared deviations, n is the count including x
+inline void add_observation(double x, int n, double &mean, double &m2) {
+    double delta = x - mean;
+    mean += delta/n;
+    m2 += delta*(x - mean);
+}
+
+#endif /* Accumulator_hpp */
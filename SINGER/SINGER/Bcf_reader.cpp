@@ -0,0 +1,219 @@
+//
+//  Bcf_reader.cpp
+//  SINGER
+//
+
+#include "Bcf_reader.hpp"
+
+Bcf_reader::Bcf_reader() {}
+
+bool Bcf_reader::open(string filename) {
+    if (!reader.open(filename)) {
+        return false;
+    }
+    char magic[5];
+    uint32_t l_text = 0;
+    if (!reader.read(magic, 5) or memcmp(magic, "BCF\2", 4) != 0 or !reader.read((char *) &l_text, 4)) {
+        cerr << "input file is not in BCF2 format: " << filename << endl;
+        exit(1);
+    }
+    string text(l_text, '\0');
+    reader.read(text.data(), l_text);
+    read_header(text);
+    first_record = reader.tell();
+    return true;
+}
+
+bool Bcf_reader::read_record(Vcf_parser::Record &record) {
+    uint32_t lengths[2];
+    if (!reader.read((char *) lengths, 8)) {
+        return false;
+    }
+    shared.resize(lengths[0]);
+    indiv.resize(lengths[1]);
+    if (!reader.read(shared.data(), lengths[0]) or !reader.read(indiv.data(), lengths[1])) {
+        cerr << "truncated BCF record" << endl;
+        exit(1);
+    }
+    const char *p = shared.data();
+    int32_t pos;
+    uint32_t n_allele_info, n_fmt_sample;
+    memcpy(&pos, p + 4, 4);
+    memcpy(&n_allele_info, p + 16, 4);
+    memcpy(&n_fmt_sample, p + 20, 4);
+    p += 24;
+    int n_allele = n_allele_info >> 16;
+    int n_sample = n_fmt_sample & 0xffffff;
+    int n_fmt = n_fmt_sample >> 24;
+    record.pos = pos + 1;
+    record.carriers.clear();
+    record.num_haplotypes = 2*n_sample;
+    int count = 0;
+    read_type(p, count); // ID
+    p += count;
+    int ref_length = 0;
+    int alt_length = 1; // "." when there is no alternative allele
+    for (int i = 0; i < n_allele; i++) {
+        read_type(p, count);
+        p += count;
+        if (i == 0) {
+            ref_length = count;
+        } else if (i == 1) {
+            alt_length = count;
+        } else {
+            alt_length += count + 1;
+        }
+    }
+    record.snp = ref_length <= 1 and alt_length <= 1;
+    if (!record.snp) {
+        return true;
+    }
+    const char *q = indiv.data();
+    for (int f = 0; f < n_fmt; f++) {
+        int key = read_typed_int(q);
+        int type = read_type(q, count);
+        int size = (type == 1 or type == 7) ? 1 : (type == 2 ? 2 : 4);
+        if (key != gt_key) {
+            q += (size_t) n_sample*count*size;
+            continue;
+        }
+        // GT values are (allele + 1) << 1 | phased, only allele 1 counts as derived
+        for (int i = 0; i < n_sample; i++) {
+            for (int j = 0; j < count; j++) {
+                int v = 0;
+                if (type == 1) {
+                    v = (int8_t) q[0];
+                } else if (type == 2) {
+                    int16_t x;
+                    memcpy(&x, q, 2);
+                    v = x;
+                } else {
+                    int32_t x;
+                    memcpy(&x, q, 4);
+                    v = x;
+                }
+                if (j < 2 and (v >> 1) - 1 == 1) {
+                    record.carriers.push_back(2*i + j);
+                }
+                q += size;
+            }
+        }
+    }
+    return true;
+}
+
+uint64_t Bcf_reader::query_csi(string index_file, double x) {
+    // the first record of the nearest non-empty leaf bin left of x, as records are sorted by position
+    Bgzf_reader index_reader = Bgzf_reader();
+    if (!index_reader.open(index_file)) {
+        return first_record;
+    }
+    char magic[4];
+    int32_t min_shift, depth, l_aux, n_ref;
+    index_reader.read(magic, 4);
+    if (memcmp(magic, "CSI\1", 4) != 0) {
+        cerr << "index file is not in CSI format: " << index_file << endl;
+        return first_record;
+    }
+    index_reader.read((char *) &min_shift, 4);
+    index_reader.read((char *) &depth, 4);
+    index_reader.read((char *) &l_aux, 4);
+    vector<char> aux(l_aux);
+    index_reader.read(aux.data(), l_aux);
+    index_reader.read((char *) &n_ref, 4);
+    uint64_t leaf_first = ((1ull << (3*depth)) - 1)/7;
+    uint64_t leaf_end = leaf_first + (1ull << (3*depth));
+    uint64_t target = (uint64_t) max(x - 1, 0.0) >> min_shift;
+    uint64_t offset = first_record;
+    for (int r = 0; r < n_ref; r++) {
+        int32_t n_bin;
+        index_reader.read((char *) &n_bin, 4);
+        for (int b = 0; b < n_bin; b++) {
+            uint32_t bin;
+            uint64_t loffset;
+            int32_t n_chunk;
+            index_reader.read((char *) &bin, 4);
+            index_reader.read((char *) &loffset, 8);
+            index_reader.read((char *) &n_chunk, 4);
+            vector<char> chunks(16*n_chunk);
+            index_reader.read(chunks.data(), chunks.size());
+            if (bin >= leaf_first and bin < leaf_end and bin - leaf_first < target) {
+                offset = max(offset, loffset);
+            }
+        }
+        if (n_bin > 0) {
+            break; // only the first contig is used, as for the text input
+        }
+    }
+    return offset;
+}
+
+// private methods:
+
+void Bcf_reader::read_header(string text) {
+    // FILTER, INFO and FORMAT share one dictionary, with PASS always first
+    map<string, int> dictionary = {{"PASS", 0}};
+    int next_key = 1;
+    istringstream iss(text);
+    string line;
+    while (getline(iss, line)) {
+        if (line.substr(0, 6) == "#CHROM") {
+            int num_fields = 1 + (int) count(line.begin(), line.end(), '\t');
+            num_haplotypes = 2*(num_fields - 9);
+            continue;
+        }
+        if (line.substr(0, 10) != "##FILTER=<" and line.substr(0, 8) != "##INFO=<" and line.substr(0, 10) != "##FORMAT=<") {
+            continue;
+        }
+        size_t id_start = line.find("ID=");
+        if (id_start == string::npos) {
+            continue;
+        }
+        id_start += 3;
+        size_t id_end = line.find_first_of(",>", id_start);
+        string id = line.substr(id_start, id_end - id_start);
+        size_t idx_start = line.find(",IDX=");
+        if (idx_start != string::npos) {
+            int idx = stoi(line.substr(idx_start + 5));
+            dictionary[id] = idx;
+            next_key = max(next_key, idx + 1);
+        } else if (dictionary.count(id) == 0) {
+            dictionary[id] = next_key;
+            next_key += 1;
+        }
+    }
+    if (dictionary.count("GT") > 0) {
+        gt_key = dictionary.at("GT");
+    }
+}
+
+int Bcf_reader::read_typed_int(const char *&p) {
+    int type = p[0] & 0xf;
+    p += 1;
+    int v = 0;
+    if (type == 1) {
+        v = (int8_t) p[0];
+        p += 1;
+    } else if (type == 2) {
+        int16_t x;
+        memcpy(&x, p, 2);
+        v = x;
+        p += 2;
+    } else {
+        int32_t x;
+        memcpy(&x, p, 4);
+        v = x;
+        p += 4;
+    }
+    return v;
+}
+
+int Bcf_reader::read_type(const char *&p, int &count) {
+    int type = p[0] & 0xf;
+    count = (p[0] >> 4) & 0xf;
+    p += 1;
+    if (count == 15) {
+        count = read_typed_int(p);
+    }
+    return type;
+}
@@ -0,0 +1,44 @@
+//
+//  Bcf_reader.hpp
+//  SINGER
+//
+
+#ifndef Bcf_reader_hpp
+#define Bcf_reader_hpp
+
+#include <stdio.h>
+#include <sstream>
+#include "Bgzf_reader.hpp"
+#include "Vcf_parser.hpp"
+
+// decodes BCF2 records straight into the records used for the text VCF input
+class Bcf_reader {
+
+public:
+
+    Bgzf_reader reader;
+    int num_haplotypes = 0;
+    int gt_key = -1;
+    uint64_t first_record = 0;
+
+    Bcf_reader();
+
+    bool open(string filename);
+
+    bool read_record(Vcf_parser::Record &record);
+
+    uint64_t query_csi(string index_file, double x);
+
+private:
+
+    vector<char> shared = {};
+    vector<char> indiv = {};
+
+    void read_header(string text);
+
+    int read_typed_int(const char *&p);
+
+    int read_type(const char *&p, int &count);
+};
+
+#endif /* Bcf_reader_hpp */
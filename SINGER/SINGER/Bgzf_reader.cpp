@@ -0,0 +1,124 @@
+//
+//  Bgzf_reader.cpp
+//  SINGER
+//
+
+#include "Bgzf_reader.hpp"
+
+Bgzf_reader::Bgzf_reader() {}
+
+bool Bgzf_reader::open(string filename) {
+    file.open(filename, ios::in|ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    seek(0);
+    return true;
+}
+
+void Bgzf_reader::seek(uint64_t virtual_offset) {
+    next_block_address = virtual_offset >> 16;
+    file.clear();
+    file.seekg(next_block_address, ios::beg);
+    block.clear();
+    block_offset = 0;
+    if (read_block()) {
+        block_offset = min((size_t) (virtual_offset & 0xffff), block.size());
+    }
+}
+
+uint64_t Bgzf_reader::tell() {
+    if (block_offset >= block.size()) {
+        return next_block_address << 16;
+    }
+    return (block_address << 16) | block_offset;
+}
+
+bool Bgzf_reader::getline(string &line) {
+    line.clear();
+    bool found = false;
+    while (!found) {
+        if (block_offset >= block.size() and !read_block()) {
+            return line.size() > 0;
+        }
+        const char *start = block.data() + block_offset;
+        size_t remaining = block.size() - block_offset;
+        const char *newline = (const char *) memchr(start, '\n', remaining);
+        size_t n = newline == nullptr ? remaining : newline - start;
+        line.append(start, n);
+        block_offset += n;
+        if (newline != nullptr) {
+            block_offset += 1;
+            found = true;
+        }
+    }
+    return true;
+}
+
+bool Bgzf_reader::read(char *buffer, size_t n) {
+    while (n > 0) {
+        if (block_offset >= block.size() and !read_block()) {
+            return false;
+        }
+        size_t m = min(n, block.size() - block_offset);
+        memcpy(buffer, block.data() + block_offset, m);
+        block_offset += m;
+        buffer += m;
+        n -= m;
+    }
+    return true;
+}
+
+// private methods:
+
+bool Bgzf_reader::read_block() {
+    unsigned char header[18];
+    if (!file.read((char *) header, 12)) {
+        return false;
+    }
+    if (header[0] != 31 or header[1] != 139 or header[2] != 8 or (header[3] & 4) == 0) {
+        cerr << "input file is not in BGZF format" << endl;
+        exit(1);
+    }
+    int xlen = header[10] | (header[11] << 8);
+    vector<unsigned char> extra(xlen);
+    file.read((char *) extra.data(), xlen);
+    int block_size = -1;
+    for (int i = 0; i + 4 <= xlen; ) {
+        int subfield_length = extra[i + 2] | (extra[i + 3] << 8);
+        if (extra[i] == 'B' and extra[i + 1] == 'C' and subfield_length == 2) {
+            block_size = (extra[i + 4] | (extra[i + 5] << 8)) + 1;
+        }
+        i += 4 + subfield_length;
+    }
+    if (block_size < 0 or !file) {
+        cerr << "input file is not in BGZF format" << endl;
+        exit(1);
+    }
+    int compressed_size = block_size - 12 - xlen - 8;
+    compressed_block.resize(compressed_size + 8);
+    if (!file.read(compressed_block.data(), compressed_size + 8)) {
+        cerr << "truncated BGZF block" << endl;
+        exit(1);
+    }
+    const unsigned char *footer = (const unsigned char *) compressed_block.data() + compressed_size;
+    uint32_t expected_crc = footer[0] | (footer[1] << 8) | (footer[2] << 16) | ((uint32_t) footer[3] << 24);
+    uint32_t uncompressed_size = footer[4] | (footer[5] << 8) | (footer[6] << 16) | ((uint32_t) footer[7] << 24);
+    block.resize(uncompressed_size);
+    z_stream stream = {};
+    inflateInit2(&stream, -15);
+    stream.next_in = (Bytef *) compressed_block.data();
+    stream.avail_in = compressed_size;
+    stream.next_out = (Bytef *) block.data();
+    stream.avail_out = uncompressed_size;
+    int status = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+    if (status != Z_STREAM_END or crc32(0, (const Bytef *) block.data(), uncompressed_size) != expected_crc) {
+        cerr << "corrupted BGZF block at byte " << next_block_address << endl;
+        exit(1);
+    }
+    block_address = next_block_address;
+    next_block_address += block_size;
+    block_offset = 0;
+    return true;
+}
@@ -0,0 +1,45 @@
+//
+//  Bgzf_reader.hpp
+//  SINGER
+//
+
+#ifndef Bgzf_reader_hpp
+#define Bgzf_reader_hpp
+
+#include <stdio.h>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <zlib.h>
+#include "Node.hpp"
+
+// reader for BGZF (.vcf.gz, .bcf) files, positions are virtual offsets: (block address << 16) | offset in block
+class Bgzf_reader {
+
+public:
+
+    Bgzf_reader();
+
+    bool open(string filename);
+
+    void seek(uint64_t virtual_offset);
+
+    uint64_t tell();
+
+    bool getline(string &line);
+
+    bool read(char *buffer, size_t n);
+
+private:
+
+    ifstream file;
+    uint64_t block_address = 0;
+    uint64_t next_block_address = 0;
+    vector<char> compressed_block = {};
+    vector<char> block = {};
+    size_t block_offset = 0;
+
+    bool read_block();
+};
+
+#endif /* Bgzf_reader_hpp */
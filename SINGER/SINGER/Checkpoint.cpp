@@ -0,0 +1,68 @@
+//
+//  Checkpoint.cpp
+//  SINGER
+//
+
+#include "Checkpoint.hpp"
+
+static const char checkpoint_magic[8] = {'S', 'I', 'N', 'G', 'E', 'R', 'C', 'K'};
+static const uint32_t checkpoint_version = 2; // 2: summaries and schedule in tagged sections
+
+void put_section(vector<char> &buffer, string tag, const vector<char> &content) {
+    put_vector(buffer, vector<char>(tag.begin(), tag.end()));
+    put_vector(buffer, content);
+}
+
+map<string, vector<char>> get_sections(const char *p, const char *end) {
+    map<string, vector<char>> sections = {};
+    while (p < end) {
+        vector<char> tag = get_vector<char>(p);
+        sections[string(tag.begin(), tag.end())] = get_vector<char>(p);
+    }
+    return sections;
+}
+
+void write_checkpoint_file(string filename, const vector<char> &buffer) {
+    // the checkpoint is replaced by a rename, so an interrupted write never leaves a partial file behind
+    // the data is synced before the rename, otherwise a power loss can leave the renamed file empty
+    string tmp_filename = filename + ".tmp";
+    FILE *file = fopen(tmp_filename.c_str(), "wb");
+    if (file == nullptr) {
+        cerr << "Error opening the file: " << tmp_filename << endl;
+        return;
+    }
+    uint64_t size = buffer.size();
+    bool ok = fwrite(checkpoint_magic, 1, 8, file) == 8;
+    ok = ok and fwrite(&checkpoint_version, 4, 1, file) == 1;
+    ok = ok and fwrite(&size, 8, 1, file) == 1;
+    ok = ok and fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    ok = ok and fflush(file) == 0 and fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 and ok;
+    if (!ok or rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+        cerr << "Error writing the file: " << filename << endl;
+    }
+}
+
+bool read_checkpoint_file(string filename, vector<char> &buffer) {
+    ifstream file(filename, ios::in|ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    char magic[8];
+    uint32_t version = 0;
+    uint64_t size = 0;
+    file.read(magic, 8);
+    file.read((char *) &version, 4);
+    file.read((char *) &size, 8);
+    if (!file or memcmp(magic, checkpoint_magic, 8) != 0 or version != checkpoint_version) {
+        cerr << "not a compatible checkpoint file: " << filename << endl;
+        return false;
+    }
+    buffer.resize(size);
+    file.read(buffer.data(), size);
+    if (!file) {
+        cerr << "truncated checkpoint file: " << filename << endl;
+        return false;
+    }
+    return true;
+}
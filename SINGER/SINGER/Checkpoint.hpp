@@ -0,0 +1,62 @@
+//
+//  Checkpoint.hpp
+//  SINGER
+//
+
+#ifndef Checkpoint_hpp
+#define Checkpoint_hpp
+
+#include <stdio.h>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include "Node.hpp"
+
+// flat binary buffers for checkpoints: values are stored as raw bytes, vectors as a uint64 length followed by the elements
+
+template<typename T>
+void put_value(vector<char> &buffer, T x) {
+    size_t n = buffer.size();
+    buffer.resize(n + sizeof(T));
+    memcpy(buffer.data() + n, &x, sizeof(T));
+}
+
+template<typename T>
+void put_vector(vector<char> &buffer, const vector<T> &v) {
+    put_value<uint64_t>(buffer, v.size());
+    size_t n = buffer.size();
+    buffer.resize(n + v.size()*sizeof(T));
+    if (v.size() > 0) {
+        memcpy(buffer.data() + n, v.data(), v.size()*sizeof(T));
+    }
+}
+
+template<typename T>
+T get_value(const char *&p) {
+    T x;
+    memcpy(&x, p, sizeof(T));
+    p += sizeof(T);
+    return x;
+}
+
+template<typename T>
+vector<T> get_vector(const char *&p) {
+    uint64_t n = get_value<uint64_t>(p);
+    vector<T> v(n);
+    if (n > 0) {
+        memcpy(v.data(), p, n*sizeof(T));
+    }
+    p += n*sizeof(T);
+    return v;
+}
+
+// optional parts after the fixed ones are sections: a tag and a byte length before the content, so a reader can skip the ones it doesn't use
+void put_section(vector<char> &buffer, string tag, const vector<char> &content);
+
+map<string, vector<char>> get_sections(const char *p, const char *end);
+
+void write_checkpoint_file(string filename, const vector<char> &buffer);
+
+bool read_checkpoint_file(string filename, vector<char> &buffer);
+
+#endif /* Checkpoint_hpp */
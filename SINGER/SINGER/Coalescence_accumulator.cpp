@@ -0,0 +1,60 @@
+//
+//  Coalescence_accumulator.cpp
+//  SINGER
+//
+
+#include "Coalescence_accumulator.hpp"
+
+Coalescence_accumulator::Coalescence_accumulator(double s, int f) : coalescence_times(s, f) {}
+
+string Coalescence_accumulator::name() {
+    return "coal";
+}
+
+void Coalescence_accumulator::update(ARG &a) {
+    coalescence_times.compute(a);
+    vector<vector<double>> &times = coalescence_times.times;
+    if (means.size() == 0) {
+        means = vector<vector<double>>(times.size(), vector<double>(times[0].size(), 0));
+        m2 = means;
+    }
+    num_samples += 1;
+    for (int w = 0; w < times.size(); w++) {
+        for (int k = 0; k < times[w].size(); k++) {
+            add_observation(times[w][k], num_samples, means[w][k], m2[w][k]);
+        }
+    }
+}
+
+void Coalescence_accumulator::write(string prefix) {
+    // same layout as the per sample files, one row per window
+    coalescence_times.times = means;
+    coalescence_times.write(prefix + "_coal_mean.csv");
+    coalescence_times.times = m2;
+    for (auto &row : coalescence_times.times) {
+        for (double &v : row) {
+            v = num_samples > 1 ? v/(num_samples - 1) : 0;
+        }
+    }
+    coalescence_times.write(prefix + "_coal_var.csv");
+}
+
+void Coalescence_accumulator::write_state(vector<char> &buffer) {
+    put_value<int>(buffer, num_samples);
+    put_value<int>(buffer, (int) means.size());
+    for (int w = 0; w < means.size(); w++) {
+        put_vector(buffer, means[w]);
+        put_vector(buffer, m2[w]);
+    }
+}
+
+void Coalescence_accumulator::read_state(const char *&p) {
+    num_samples = get_value<int>(p);
+    int num_windows = get_value<int>(p);
+    means.resize(num_windows);
+    m2.resize(num_windows);
+    for (int w = 0; w < num_windows; w++) {
+        means[w] = get_vector<double>(p);
+        m2[w] = get_vector<double>(p);
+    }
+}
@@ -0,0 +1,35 @@
+//
+//  Coalescence_accumulator.hpp
+//  SINGER
+//
+
+#ifndef Coalescence_accumulator_hpp
+#define Coalescence_accumulator_hpp
+
+#include <stdio.h>
+#include "Accumulator.hpp"
+#include "Coalescence_times.hpp"
+
+// running mean and variance over samples of the windowed pairwise coalescence times from Coalescence_times
+class Coalescence_accumulator : public Accumulator {
+
+public:
+
+    Coalescence_times coalescence_times;
+    vector<vector<double>> means = {};
+    vector<vector<double>> m2 = {};
+
+    Coalescence_accumulator(double s, int f);
+
+    string name() override;
+
+    void update(ARG &a) override;
+
+    void write(string prefix) override;
+
+    void write_state(vector<char> &buffer) override;
+
+    void read_state(const char *&p) override;
+};
+
+#endif /* Coalescence_accumulator_hpp */
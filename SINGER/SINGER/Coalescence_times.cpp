@@ -0,0 +1,193 @@
+//
+//  Coalescence_times.cpp
+//  SINGER
+//
+
+#include "Coalescence_times.hpp"
+
+Coalescence_times::Coalescence_times(double s, int f) {
+    window_size = s;
+    focal = f;
+}
+
+void Coalescence_times::compute(ARG &a) {
+    Ne = a.Ne;
+    sequence_length = a.sequence_length;
+    vector<Node_ptr> samples = vector<Node_ptr>(a.sample_nodes.begin(), a.sample_nodes.end());
+    num_samples = (int) samples.size();
+    if (focal >= num_samples) {
+        cerr << "focal sample " << focal << " not found" << endl;
+        exit(1);
+    }
+    sample_ids.clear();
+    for (int i = 0; i < num_samples; i++) {
+        sample_ids[samples[i]] = i;
+    }
+    columns.clear();
+    for (int i = 0; i < num_samples; i++) {
+        for (int j = i + 1; j < num_samples; j++) {
+            if (focal < 0) {
+                columns.push_back({i, j});
+            } else if (i == focal) {
+                columns.push_back({i, j});
+            } else if (j == focal) {
+                columns.push_back({j, i});
+            }
+        }
+    }
+    sort(columns.begin(), columns.end(), [&](const pair<int, int> &x, const pair<int, int> &y) {return column(x.first, x.second) < column(y.first, y.second);});
+    num_windows = max(1, (int) ceil(sequence_length/window_size));
+    times = vector<vector<double>>(num_windows, vector<double>(columns.size(), 0));
+    values = vector<double>(columns.size(), 0);
+    since = vector<double>(columns.size(), 0);
+    tree = Tree();
+    vector<int> stamps = vector<int>(num_samples, -1);
+    vector<int> changed = {};
+    vector<int> below = {};
+    int step = 0;
+    for (auto &x : a.recombinations) {
+        double pos = x.first;
+        if (pos >= sequence_length) {
+            break;
+        }
+        Recombination &r = x.second;
+        tree.forward_update(r);
+        // a pair can only change if the path of one of its samples passes through a node with a new parent
+        changed.clear();
+        for (const Branch &b : r.inserted_branches) {
+            below.clear();
+            collect_samples(b.lower_node, below);
+            for (int i : below) {
+                if (stamps[i] != step) {
+                    stamps[i] = step;
+                    changed.push_back(i);
+                }
+            }
+        }
+        if (focal < 0) {
+            for (int i : changed) {
+                update_row(i, samples[i], pos);
+            }
+        } else if (stamps[focal] == step) {
+            update_row(focal, samples[focal], pos);
+        } else {
+            unordered_set<Node_ptr> focal_path = {};
+            Node_ptr n = samples[focal];
+            while (n != nullptr and n->index != -1) {
+                focal_path.insert(n);
+                auto it = tree.parents.find(n);
+                n = it == tree.parents.end() ? nullptr : it->second;
+            }
+            for (int i : changed) {
+                n = samples[i];
+                while (focal_path.count(n) == 0) {
+                    n = tree.parents.at(n);
+                }
+                set_pair(focal, i, n->time, pos);
+            }
+        }
+        step += 1;
+    }
+    for (int k = 0; k < columns.size(); k++) {
+        add_span(k, since[k], sequence_length);
+    }
+    for (int w = 0; w < num_windows; w++) {
+        double window_length = min((w + 1)*window_size, sequence_length) - w*window_size;
+        for (double &t : times[w]) {
+            t *= Ne/window_length;
+        }
+    }
+}
+
+void Coalescence_times::write(string filename) {
+    ofstream file(filename);
+    if (!file) {
+        cerr << "Error opening the file: " << filename << endl;
+        return;
+    }
+    file << std::setprecision(18) << std::scientific;
+    for (auto &row : times) {
+        for (int k = 0; k < row.size(); k++) {
+            file << row[k] << (k + 1 < row.size() ? "," : "\n");
+        }
+    }
+    file.close();
+}
+
+// private methods:
+
+int Coalescence_times::column(int i, int j) {
+    if (i == j) {
+        return -1;
+    }
+    if (focal >= 0) {
+        if (i != focal and j != focal) {
+            return -1;
+        }
+        int other = i == focal ? j : i;
+        return other < focal ? other : other - 1;
+    }
+    if (i > j) {
+        swap(i, j);
+    }
+    return i*num_samples - i*(i + 1)/2 + j - i - 1;
+}
+
+void Coalescence_times::set_pair(int i, int j, double t, double x) {
+    int k = column(i, j);
+    if (k < 0 or values[k] == t) {
+        return;
+    }
+    add_span(k, since[k], x);
+    values[k] = t;
+    since[k] = x;
+}
+
+void Coalescence_times::add_span(int k, double x, double y) {
+    int w = (int) (x/window_size);
+    while (x < y and w < num_windows) {
+        double window_end = w == num_windows - 1 ? sequence_length : (w + 1)*window_size;
+        double z = min(y, window_end);
+        times[w][k] += values[k]*(z - x);
+        x = z;
+        w += 1;
+    }
+}
+
+void Coalescence_times::collect_samples(Node_ptr n, vector<int> &ids) {
+    vector<Node_ptr> stack = {n};
+    while (stack.size() > 0) {
+        Node_ptr m = stack.back();
+        stack.pop_back();
+        auto it = tree.children.find(m);
+        if (it == tree.children.end()) {
+            auto sample_it = sample_ids.find(m);
+            if (sample_it != sample_ids.end()) {
+                ids.push_back(sample_it->second);
+            }
+        } else {
+            stack.insert(stack.end(), it->second.begin(), it->second.end());
+        }
+    }
+}
+
+void Coalescence_times::update_row(int i, Node_ptr n, double x) {
+    // every sample below a side branch of the path from n to the root coalesces with n at the top of that branch
+    vector<int> ids = {};
+    Node_ptr prev = n;
+    auto it = tree.parents.find(prev);
+    while (it != tree.parents.end() and it->second->index != -1) {
+        Node_ptr curr = it->second;
+        for (Node_ptr c : tree.children.at(curr)) {
+            if (c != prev) {
+                ids.clear();
+                collect_samples(c, ids);
+                for (int j : ids) {
+                    set_pair(i, j, curr->time, x);
+                }
+            }
+        }
+        prev = curr;
+        it = tree.parents.find(prev);
+    }
+}
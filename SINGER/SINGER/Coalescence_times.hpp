@@ -0,0 +1,52 @@
+//
+//  Coalescence_times.hpp
+//  SINGER
+//
+
+#ifndef Coalescence_times_hpp
+#define Coalescence_times_hpp
+
+#include <stdio.h>
+#include <iomanip>
+#include "ARG.hpp"
+
+// windowed mean pairwise coalescence times of one focal sample against all others (or of all pairs when focal is -1)
+// computed in one sweep over the recombinations, only the pairs whose path in the tree changed are updated
+class Coalescence_times {
+
+public:
+
+    double window_size = 10000;
+    int focal = -1;
+    double Ne = 1;
+    int num_windows = 0;
+    vector<pair<int, int>> columns = {}; // sample pair of each column
+    vector<vector<double>> times = {}; // window by column
+
+    Coalescence_times(double s, int f);
+
+    void compute(ARG &a);
+
+    void write(string filename);
+
+private:
+
+    int num_samples = 0;
+    double sequence_length = 0;
+    Tree tree;
+    unordered_map<Node_ptr, int> sample_ids = {};
+    vector<double> values = {};
+    vector<double> since = {};
+
+    int column(int i, int j);
+
+    void set_pair(int i, int j, double t, double x);
+
+    void add_span(int k, double x, double y);
+
+    void collect_samples(Node_ptr n, vector<int> &ids);
+
+    void update_row(int i, Node_ptr n, double x);
+};
+
+#endif /* Coalescence_times_hpp */
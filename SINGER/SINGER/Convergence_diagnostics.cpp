@@ -0,0 +1,194 @@
+//
+//  Convergence_diagnostics.cpp
+//  SINGER
+//
+
+#include "Convergence_diagnostics.hpp"
+
+Convergence_diagnostics::Convergence_diagnostics() {}
+
+void Convergence_diagnostics::add(int index, double arg_length, ARG &a) {
+    indices.push_back(index);
+    traces[0].push_back(arg_length);
+    traces[1].push_back(a.recombinations.size() - 2);
+    traces[2].push_back(a.num_unmapped());
+}
+
+void Convergence_diagnostics::compute() {
+    vector<vector<vector<double>>> chains = vector<vector<vector<double>>>(traces.size());
+    for (int s = 0; s < traces.size(); s++) {
+        chains[s].push_back(traces[s]);
+    }
+    vector<int> rows = {};
+    vector<vector<double>> values = {};
+    for (string &filename : other_files) {
+        if (read_trace(filename, rows, values)) {
+            for (int s = 0; s < traces.size(); s++) {
+                chains[s].push_back(values[s]);
+            }
+        }
+    }
+    for (int s = 0; s < traces.size(); s++) {
+        compute(chains[s], ess[s], rhat[s]);
+    }
+}
+
+bool Convergence_diagnostics::reached(double target_ess) {
+    for (int s = 0; s < traces.size(); s++) {
+        if (ess[s] < target_ess or rhat[s] > target_rhat) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Convergence_diagnostics::read_trace(string filename, int limit) {
+    vector<int> rows = {};
+    vector<vector<double>> values = {};
+    indices.clear();
+    traces = vector<vector<double>>(names.size());
+    if (!read_trace(filename, rows, values)) {
+        return;
+    }
+    for (int i = 0; i < rows.size() and rows[i] < limit; i++) {
+        indices.push_back(rows[i]);
+        for (int s = 0; s < traces.size(); s++) {
+            traces[s].push_back(values[s][i]);
+        }
+    }
+}
+
+void Convergence_diagnostics::write_trace(string filename) {
+    ofstream file(filename);
+    if (!file) {
+        cerr << "Error opening the file: " << filename << endl;
+        return;
+    }
+    file << "Iteration:";
+    for (string &name : names) {
+        file << "\t" << name;
+    }
+    file << endl;
+    file.close();
+    for (int i = 0; i < indices.size(); i++) {
+        append_trace(filename, i);
+    }
+}
+
+void Convergence_diagnostics::append_trace(string filename) {
+    append_trace(filename, (int) indices.size() - 1);
+}
+
+// private methods:
+
+void Convergence_diagnostics::append_trace(string filename, int i) {
+    ofstream file(filename, ios::out|ios::app);
+    if (!file) {
+        cerr << "Error opening the file: " << filename << endl;
+        return;
+    }
+    file << setprecision(numeric_limits<double>::max_digits10) << indices[i];
+    for (auto &trace : traces) {
+        file << "\t" << trace[i];
+    }
+    file << endl;
+}
+
+bool Convergence_diagnostics::read_trace(string filename, vector<int> &rows, vector<vector<double>> &values) {
+    ifstream file(filename);
+    if (!file) {
+        return false;
+    }
+    rows.clear();
+    values = vector<vector<double>>(names.size());
+    string line;
+    getline(file, line); // header
+    while (getline(file, line)) {
+        istringstream words(line);
+        int index;
+        vector<double> row = vector<double>(names.size());
+        if (!(words >> index)) {
+            break;
+        }
+        for (double &x : row) {
+            words >> x;
+        }
+        if (!words) { // a line still being written by another chain
+            break;
+        }
+        rows.push_back(index);
+        for (int s = 0; s < names.size(); s++) {
+            values[s].push_back(row[s]);
+        }
+    }
+    return true;
+}
+
+void Convergence_diagnostics::compute(vector<vector<double>> &chains, double &e, double &r) {
+    e = 0;
+    r = INFINITY;
+    size_t length = chains[0].size();
+    for (auto &chain : chains) {
+        length = min(length, chain.size());
+    }
+    // drop the first half as burn-in and split the rest in two, so that a trend within a chain shows up in R-hat
+    int n = (int) (length/2)/2;
+    if (n < 4) {
+        return;
+    }
+    vector<vector<double>> splits = {};
+    for (auto &chain : chains) {
+        auto last = chain.begin() + length;
+        splits.push_back(vector<double>(last - 2*n, last - n));
+        splits.push_back(vector<double>(last - n, last));
+    }
+    int m = (int) splits.size();
+    vector<double> means = vector<double>(m, 0);
+    vector<double> vars = vector<double>(m, 0);
+    double grand_mean = 0;
+    for (int j = 0; j < m; j++) {
+        for (double x : splits[j]) {
+            means[j] += x;
+        }
+        means[j] /= n;
+        for (double x : splits[j]) {
+            vars[j] += (x - means[j])*(x - means[j])/(n - 1);
+        }
+        grand_mean += means[j]/m;
+    }
+    double W = 0, B = 0;
+    for (int j = 0; j < m; j++) {
+        W += vars[j]/m;
+        B += (means[j] - grand_mean)*(means[j] - grand_mean)/(m - 1);
+    }
+    double var_plus = (n - 1.0)/n*W + B;
+    if (var_plus <= 1e-24*grand_mean*grand_mean) { // a constant statistic, e.g. no unmapped mutations at all
+        e = m*n;
+        r = 1;
+        return;
+    }
+    r = sqrt(var_plus/W);
+    // Geyer's initial monotone sequence over the autocorrelations combined across chains
+    auto rho = [&](int t) {
+        double acov = 0;
+        for (int j = 0; j < m; j++) {
+            for (int i = 0; i + t < n; i++) {
+                acov += (splits[j][i] - means[j])*(splits[j][i + t] - means[j])/n;
+            }
+        }
+        acov /= m;
+        return 1 - (W - acov)/var_plus;
+    };
+    double tau = -1;
+    double prev_pair = INFINITY;
+    for (int t = 0; t + 1 < n; t += 2) {
+        double pair = (t == 0 ? 1 : rho(t)) + rho(t + 1);
+        if (pair < 0) {
+            break;
+        }
+        pair = min(pair, prev_pair);
+        tau += 2*pair;
+        prev_pair = pair;
+    }
+    e = m*n/max(tau, 1.0/log10(m*n));
+}
@@ -0,0 +1,51 @@
+//
+//  Convergence_diagnostics.hpp
+//  SINGER
+//
+
+#ifndef Convergence_diagnostics_hpp
+#define Convergence_diagnostics_hpp
+
+#include <stdio.h>
+#include <sstream>
+#include "ARG.hpp"
+
+// effective sample size and split R-hat (Vehtari et al. 2021) of the ARG length, the number of recombinations
+// and the number of mutations not uniquely mapped, over this chain and the traces of other chains
+// the first half of every trace is discarded as burn-in
+class Convergence_diagnostics {
+
+public:
+
+    vector<string> names = {"ARG_length", "#Recombinations", "#Mutations_not_uniquely_mapped"};
+    vector<int> indices = {};
+    vector<vector<double>> traces = vector<vector<double>>(3); // statistic by sample
+    vector<string> other_files = {}; // trace files of other chains, read again at every update
+    vector<double> ess = vector<double>(3, 0);
+    vector<double> rhat = vector<double>(3, INFINITY);
+    double target_rhat = 1.01;
+
+    Convergence_diagnostics();
+
+    void add(int index, double arg_length, ARG &a);
+
+    void compute();
+
+    bool reached(double target_ess);
+
+    void read_trace(string filename, int limit); // own trace up to sample limit, for resuming
+
+    void write_trace(string filename);
+
+    void append_trace(string filename);
+
+private:
+
+    bool read_trace(string filename, vector<int> &rows, vector<vector<double>> &values);
+
+    void append_trace(string filename, int i);
+
+    void compute(vector<vector<double>> &chains, double &e, double &r);
+};
+
+#endif /* Convergence_diagnostics_hpp */
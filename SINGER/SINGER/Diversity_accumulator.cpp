@@ -0,0 +1,99 @@
+//
+//  Diversity_accumulator.cpp
+//  SINGER
+//
+
+#include "Diversity_accumulator.hpp"
+
+string Diversity_accumulator::name() {
+    return "diversity";
+}
+
+void Diversity_accumulator::update(ARG &a) {
+    trace.push_back(diversity(a));
+    num_samples += 1;
+}
+
+void Diversity_accumulator::write(string prefix) {
+    string filename = prefix + "_diversity.txt";
+    ofstream file(filename);
+    if (!file) {
+        cerr << "Error opening the file: " << filename << endl;
+        return;
+    }
+    file.precision(numeric_limits<double>::max_digits10);
+    for (int i = 0; i < trace.size(); i++) {
+        file << i << " " << trace[i] << endl;
+    }
+    file.close();
+}
+
+void Diversity_accumulator::write_state(vector<char> &buffer) {
+    put_value<int>(buffer, num_samples);
+    put_vector(buffer, trace);
+}
+
+void Diversity_accumulator::read_state(const char *&p) {
+    num_samples = get_value<int>(p);
+    trace = get_vector<double>(p);
+}
+
+double Diversity_accumulator::diversity(ARG &a) {
+    double n = a.sample_nodes.size();
+    tree = Tree();
+    counts.clear();
+    contributions.clear();
+    double sum = 0; // over the branches of the current tree
+    double total = 0; // over the sequence
+    set<Node_ptr, compare_node> dirty = {};
+    auto it = a.recombinations.begin();
+    while (it->first < a.sequence_length) {
+        Recombination &r = it->second;
+        dirty.clear();
+        for (const Branch &b : r.deleted_branches) {
+            add_ancestors(b.lower_node, dirty);
+        }
+        tree.forward_update(r);
+        for (const Branch &b : r.inserted_branches) {
+            add_ancestors(b.lower_node, dirty);
+        }
+        // ascending time, so the counts of the children are up to date
+        for (Node_ptr v : dirty) {
+            sum -= contributions[v];
+            auto parent_it = tree.parents.find(v);
+            if (parent_it == tree.parents.end()) {
+                counts.erase(v);
+                contributions.erase(v);
+                continue;
+            }
+            int k = 0;
+            auto children_it = tree.children.find(v);
+            if (children_it == tree.children.end()) {
+                k = 1;
+            } else {
+                for (Node_ptr c : children_it->second) {
+                    k += counts[c];
+                }
+            }
+            counts[v] = k;
+            Node_ptr p = parent_it->second;
+            double c = p->index == -1 ? 0 : (p->time - v->time)*k*(n - k);
+            contributions[v] = c;
+            sum += c;
+        }
+        double x = it->first;
+        it++;
+        total += sum*(min(it->first, a.sequence_length) - x);
+    }
+    return a.Ne*total/a.sequence_length/(0.5*n*(n - 1));
+}
+
+// private methods:
+
+void Diversity_accumulator::add_ancestors(Node_ptr n, set<Node_ptr, compare_node> &nodes) {
+    while (n != nullptr and n->index != -1) {
+        nodes.insert(n);
+        auto it = tree.parents.find(n);
+        n = it == tree.parents.end() ? nullptr : it->second;
+    }
+}
@@ -0,0 +1,42 @@
+//
+//  Diversity_accumulator.hpp
+//  SINGER
+//
+
+#ifndef Diversity_accumulator_hpp
+#define Diversity_accumulator_hpp
+
+#include <stdio.h>
+#include "Accumulator.hpp"
+
+// trace of the branch length diversity (mean pairwise branch distance, tskit's branch mode diversity) of each sample
+// each tree contributes sum of (branch length)*k*(n - k) over branches with k samples below, only the branches
+// whose number of samples below can change are updated at a recombination
+class Diversity_accumulator : public Accumulator {
+
+public:
+
+    vector<double> trace = {};
+
+    string name() override;
+
+    void update(ARG &a) override;
+
+    void write(string prefix) override;
+
+    void write_state(vector<char> &buffer) override;
+
+    void read_state(const char *&p) override;
+
+    double diversity(ARG &a);
+
+private:
+
+    Tree tree;
+    unordered_map<Node_ptr, int> counts = {};
+    unordered_map<Node_ptr, double> contributions = {};
+
+    void add_ancestors(Node_ptr n, set<Node_ptr, compare_node> &nodes);
+};
+
+#endif /* Diversity_accumulator_hpp */
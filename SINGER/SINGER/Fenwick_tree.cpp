@@ -0,0 +1,60 @@
+//
+//  Fenwick_tree.cpp
+//  SINGER
+//
+
+#include "Fenwick_tree.hpp"
+
+Fenwick_tree::Fenwick_tree() {}
+
+Fenwick_tree::Fenwick_tree(int n) {
+    weights.assign(n, 0);
+    sums.assign(n + 1, 0);
+}
+
+int Fenwick_tree::size() {
+    return (int) weights.size();
+}
+
+double Fenwick_tree::total() {
+    return prefix(size());
+}
+
+double Fenwick_tree::prefix(int i) {
+    double s = 0;
+    while (i > 0) {
+        s += sums[i];
+        i -= i & -i;
+    }
+    return s;
+}
+
+void Fenwick_tree::set(int i, double w) {
+    double d = w - weights[i];
+    if (d == 0) {
+        return;
+    }
+    weights[i] = w;
+    int n = size();
+    for (int j = i + 1; j <= n; j += j & -j) {
+        sums[j] += d;
+    }
+}
+
+int Fenwick_tree::find(double u) {
+    int n = size();
+    int step = 1;
+    while (2*step <= n) {
+        step *= 2;
+    }
+    int i = 0;
+    while (step > 0) {
+        if (i + step <= n and sums[i + step] <= u) {
+            i += step;
+            u -= sums[i];
+        }
+        step /= 2;
+    }
+    // i is the largest index with prefix(i) <= u, so weights[i] > 0 unless u reached the total by rounding
+    return min(i, n - 1);
+}
@@ -0,0 +1,41 @@
+//
+//  Fenwick_tree.hpp
+//  SINGER
+//
+
+#ifndef Fenwick_tree_hpp
+#define Fenwick_tree_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+// non-negative weights with their prefix sums, a weight can be changed and an index found by its prefix sum in O(log n)
+class Fenwick_tree {
+
+public:
+
+    vector<double> weights = {};
+
+    Fenwick_tree();
+
+    Fenwick_tree(int n); // n weights of 0
+
+    int size();
+
+    double total();
+
+    double prefix(int i); // sum of the weights before i
+
+    void set(int i, double w);
+
+    int find(double u); // the index i with prefix(i) <= u < prefix(i + 1), for 0 <= u < total()
+
+private:
+
+    vector<double> sums = {}; // sums[i] is the sum of the weights in (i - lowbit(i), i], counted from 1
+};
+
+#endif /* Fenwick_tree_hpp */
@@ -0,0 +1,133 @@
+//
+//  Genotype_cache.cpp
+//  SINGER
+//
+
+#include "Genotype_cache.hpp"
+
+static const uint32_t genotype_cache_version = 1;
+
+Genotype_cache::Genotype_cache() {}
+
+Genotype_cache::~Genotype_cache() {
+    if (mapped_size > 0) {
+        munmap((void *) data, mapped_size);
+    }
+}
+
+bool Genotype_cache::open(string filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    if (st.st_size < 64) {
+        ::close(fd);
+        return false;
+    }
+    void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    data = (const char *) p;
+    mapped_size = st.st_size;
+    if (memcmp(data, "SGTCACHE", 8) != 0) {
+        cerr << "not a genotype cache file: " << filename << endl;
+        return false;
+    }
+    uint32_t version;
+    memcpy(&version, data + 8, 4);
+    if (version != genotype_cache_version) {
+        cerr << "genotype cache " << filename << " has version " << version << ", expected " << genotype_cache_version << endl;
+        return false;
+    }
+    uint32_t n;
+    uint64_t header[6];
+    memcpy(&n, data + 12, 4);
+    memcpy(header, data + 16, 48);
+    num_haplotypes = n;
+    num_sites = header[0];
+    num_removed = header[1];
+    num_monomorphic = header[2];
+    source_size = header[3];
+    words_per_site = header[4];
+    source_mtime = header[5];
+    bits = (const uint64_t *) (data + 64);
+    positions = (const int32_t *) (data + 64 + 8*num_sites*words_per_site);
+    removed_positions = positions + num_sites;
+    if ((const char *) (removed_positions + num_removed) > data + mapped_size) {
+        cerr << "truncated genotype cache file: " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+void Genotype_cache::start_write(string filename, int n, uint64_t input_size, uint64_t input_mtime) {
+    // written to a temporary file and renamed at the end, so a running job never sees a partial cache
+    write_filename = filename;
+    num_haplotypes = n;
+    words_per_site = (n + 63)/64;
+    num_sites = 0;
+    num_removed = 0;
+    num_monomorphic = 0;
+    source_size = input_size;
+    source_mtime = input_mtime;
+    row.resize(words_per_site);
+    file.open(filename + ".tmp", ios::out|ios::binary|ios::trunc);
+    if (!file) {
+        cerr << "Error opening the file: " << filename + ".tmp" << endl;
+        exit(1);
+    }
+    write_header();
+}
+
+void Genotype_cache::write_site(int pos, const vector<int> &carriers) {
+    fill(row.begin(), row.end(), 0);
+    for (int h : carriers) {
+        if (h < num_haplotypes) {
+            row[h >> 6] |= 1ull << (h & 63);
+        }
+    }
+    file.write((const char *) row.data(), 8*words_per_site);
+    write_positions.push_back(pos);
+    num_sites += 1;
+}
+
+void Genotype_cache::write_removed(int pos) {
+    write_removed_positions.push_back(pos);
+    num_removed += 1;
+}
+
+void Genotype_cache::write_monomorphic() {
+    num_monomorphic += 1;
+}
+
+void Genotype_cache::finish_write() {
+    file.write((const char *) write_positions.data(), 4*write_positions.size());
+    file.write((const char *) write_removed_positions.data(), 4*write_removed_positions.size());
+    file.seekp(0);
+    write_header();
+    file.close();
+    if (!file or rename((write_filename + ".tmp").c_str(), write_filename.c_str()) != 0) {
+        cerr << "Error writing the file: " << write_filename << endl;
+        exit(1);
+    }
+    write_positions.clear();
+    write_removed_positions.clear();
+}
+
+// private methods:
+
+void Genotype_cache::write_header() {
+    char header[64] = {};
+    uint32_t version = genotype_cache_version;
+    uint32_t n = num_haplotypes;
+    uint64_t fields[6] = {num_sites, num_removed, num_monomorphic, source_size, words_per_site, source_mtime};
+    memcpy(header, "SGTCACHE", 8);
+    memcpy(header + 8, &version, 4);
+    memcpy(header + 12, &n, 4);
+    memcpy(header + 16, fields, 48);
+    file.write(header, 64);
+}
@@ -0,0 +1,64 @@
+//
+//  Genotype_cache.hpp
+//  SINGER
+//
+
+#ifndef Genotype_cache_hpp
+#define Genotype_cache_hpp
+
+#include <stdio.h>
+#include <cstring>
+#include <cstdint>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Node.hpp"
+
+// filtered sites with bit-packed haplotypes, written once by -prepare and memory-mapped by every run
+// layout: 64 byte header, num_sites rows of words_per_site uint64, site positions (int32), removed positions (int32)
+class Genotype_cache {
+
+public:
+
+    int num_haplotypes = 0;
+    size_t words_per_site = 0;
+    size_t num_sites = 0;
+    size_t num_removed = 0;
+    size_t num_monomorphic = 0;
+    uint64_t source_size = 0;
+    uint64_t source_mtime = 0;
+    const uint64_t *bits = nullptr;
+    const int32_t *positions = nullptr;
+    const int32_t *removed_positions = nullptr;
+
+    Genotype_cache();
+
+    ~Genotype_cache();
+
+    bool open(string filename);
+
+    void start_write(string filename, int n, uint64_t input_size, uint64_t input_mtime);
+
+    void write_site(int pos, const vector<int> &carriers);
+
+    void write_removed(int pos);
+
+    void write_monomorphic();
+
+    void finish_write();
+
+private:
+
+    const char *data = nullptr;
+    size_t mapped_size = 0;
+    string write_filename = "";
+    ofstream file;
+    vector<int32_t> write_positions = {};
+    vector<int32_t> write_removed_positions = {};
+    vector<uint64_t> row = {};
+
+    void write_header();
+};
+
+#endif /* Genotype_cache_hpp */
@@ -0,0 +1,78 @@
+//
+//  Kastore.cpp
+//  SINGER
+//
+
+#include "Kastore.hpp"
+
+Kastore::Kastore() {}
+
+void Kastore::put_string(string key, string value) {
+    vector<char> chars = vector<char>(value.begin(), value.end());
+    put(key, INT8, chars);
+}
+
+void Kastore::dump(string filename) {
+    // keys have to be sorted for readers to binary search them
+    sort(items.begin(), items.end(), [](const Item &a, const Item &b) {return a.key < b.key;});
+    const size_t header_size = 64;
+    const size_t descriptor_size = 64;
+    uint64_t offset = header_size + descriptor_size*items.size();
+    vector<uint64_t> key_starts = {};
+    vector<uint64_t> array_starts = {};
+    for (const Item &item : items) {
+        key_starts.push_back(offset);
+        offset += item.key.size();
+    }
+    for (const Item &item : items) {
+        offset = (offset + 7)/8*8; // arrays are 8-byte aligned
+        array_starts.push_back(offset);
+        offset += item.data.size();
+    }
+    vector<char> buffer(offset, 0);
+    memcpy(buffer.data(), "\211KAS\r\n\032\n", 8);
+    write_uint16(buffer.data() + 8, 1);
+    write_uint16(buffer.data() + 10, 0);
+    write_uint32(buffer.data() + 12, (uint32_t) items.size());
+    write_uint64(buffer.data() + 16, offset);
+    for (int i = 0; i < items.size(); i++) {
+        const Item &item = items[i];
+        char *descriptor = buffer.data() + header_size + i*descriptor_size;
+        descriptor[0] = (char) item.type;
+        write_uint64(descriptor + 8, key_starts[i]);
+        write_uint64(descriptor + 16, item.key.size());
+        write_uint64(descriptor + 24, array_starts[i]);
+        write_uint64(descriptor + 32, item.length);
+        memcpy(buffer.data() + key_starts[i], item.key.data(), item.key.size());
+        if (item.data.size() > 0) {
+            memcpy(buffer.data() + array_starts[i], item.data.data(), item.data.size());
+        }
+    }
+    ofstream file(filename, ios::out|ios::binary|ios::trunc);
+    if (!file) {
+        cerr << "Error opening the file: " << filename << endl;
+        return;
+    }
+    file.write(buffer.data(), buffer.size());
+    file.close();
+}
+
+// private methods:
+
+void Kastore::write_uint16(char *buffer, uint16_t x) {
+    for (int i = 0; i < 2; i++) {
+        buffer[i] = (char) ((x >> (8*i)) & 0xff);
+    }
+}
+
+void Kastore::write_uint32(char *buffer, uint32_t x) {
+    for (int i = 0; i < 4; i++) {
+        buffer[i] = (char) ((x >> (8*i)) & 0xff);
+    }
+}
+
+void Kastore::write_uint64(char *buffer, uint64_t x) {
+    for (int i = 0; i < 8; i++) {
+        buffer[i] = (char) ((x >> (8*i)) & 0xff);
+    }
+}
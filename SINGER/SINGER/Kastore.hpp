@@ -0,0 +1,65 @@
+//
+//  Kastore.hpp
+//  SINGER
+//
+
+#ifndef Kastore_hpp
+#define Kastore_hpp
+
+#include <stdio.h>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include "Node.hpp"
+
+// minimal writer for the kastore key-array format used by tskit .trees files
+class Kastore {
+
+public:
+
+    static const int INT8 = 0;
+    static const int UINT8 = 1;
+    static const int INT32 = 4;
+    static const int UINT32 = 5;
+    static const int INT64 = 6;
+    static const int UINT64 = 7;
+    static const int FLOAT64 = 9;
+
+    struct Item {
+        string key;
+        int type = 0;
+        size_t length = 0;
+        vector<char> data = {};
+    };
+
+    vector<Item> items = {};
+
+    Kastore();
+
+    template<typename T>
+    void put(string key, int type, const vector<T> &values) {
+        Item item;
+        item.key = key;
+        item.type = type;
+        item.length = values.size();
+        item.data.resize(values.size()*sizeof(T));
+        if (values.size() > 0) {
+            memcpy(item.data.data(), values.data(), item.data.size());
+        }
+        items.push_back(move(item));
+    }
+
+    void put_string(string key, string value);
+
+    void dump(string filename);
+
+private:
+
+    void write_uint16(char *buffer, uint16_t x);
+
+    void write_uint32(char *buffer, uint32_t x);
+
+    void write_uint64(char *buffer, uint64_t x);
+};
+
+#endif /* Kastore_hpp */
@@ -0,0 +1,98 @@
+//
+//  Mutation_age_accumulator.cpp
+//  SINGER
+//
+
+#include "Mutation_age_accumulator.hpp"
+
+string Mutation_age_accumulator::name() {
+    return "mutation_ages";
+}
+
+void Mutation_age_accumulator::update(ARG &a) {
+    Ne = a.Ne;
+    for (auto &x : a.mutation_branches) {
+        double m = x.first;
+        if (m <= 0 or m >= a.sequence_length) {
+            continue;
+        }
+        int k = site_id(m);
+        for (const Branch &b : x.second) {
+            lower_counts[k] += 1;
+            add_observation(b.lower_node->time, lower_counts[k], lower_means[k], lower_m2[k]);
+            if (b.upper_node->index != -1) {
+                upper_counts[k] += 1;
+                add_observation(b.upper_node->time, upper_counts[k], upper_means[k], upper_m2[k]);
+            }
+        }
+    }
+    num_samples += 1;
+}
+
+void Mutation_age_accumulator::write(string prefix) {
+    string filename = prefix + "_mutation_ages.txt";
+    ofstream file(filename);
+    if (!file) {
+        cerr << "Error opening the file: " << filename << endl;
+        return;
+    }
+    file.precision(numeric_limits<double>::max_digits10);
+    vector<int> order = vector<int>(positions.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&](int i, int j) {return positions[i] < positions[j];});
+    // position, then count, mean and variance of the lower and of the upper age, times are in generations
+    for (int k : order) {
+        double lower_var = lower_counts[k] > 1 ? lower_m2[k]/(lower_counts[k] - 1) : 0;
+        double upper_var = upper_counts[k] > 1 ? upper_m2[k]/(upper_counts[k] - 1) : 0;
+        file << positions[k] << " " << lower_counts[k] << " " << Ne*lower_means[k] << " " << Ne*Ne*lower_var << " ";
+        file << upper_counts[k] << " " << Ne*upper_means[k] << " " << Ne*Ne*upper_var << endl;
+    }
+    file.close();
+}
+
+void Mutation_age_accumulator::write_state(vector<char> &buffer) {
+    put_value<int>(buffer, num_samples);
+    put_value<double>(buffer, Ne);
+    put_vector(buffer, positions);
+    put_vector(buffer, lower_counts);
+    put_vector(buffer, lower_means);
+    put_vector(buffer, lower_m2);
+    put_vector(buffer, upper_counts);
+    put_vector(buffer, upper_means);
+    put_vector(buffer, upper_m2);
+}
+
+void Mutation_age_accumulator::read_state(const char *&p) {
+    num_samples = get_value<int>(p);
+    Ne = get_value<double>(p);
+    positions = get_vector<double>(p);
+    lower_counts = get_vector<int>(p);
+    lower_means = get_vector<double>(p);
+    lower_m2 = get_vector<double>(p);
+    upper_counts = get_vector<int>(p);
+    upper_means = get_vector<double>(p);
+    upper_m2 = get_vector<double>(p);
+    site_ids.clear();
+    for (int k = 0; k < positions.size(); k++) {
+        site_ids[positions[k]] = k;
+    }
+}
+
+// private methods:
+
+int Mutation_age_accumulator::site_id(double m) {
+    auto it = site_ids.find(m);
+    if (it != site_ids.end()) {
+        return it->second;
+    }
+    int k = (int) positions.size();
+    site_ids[m] = k;
+    positions.push_back(m);
+    lower_counts.push_back(0);
+    lower_means.push_back(0);
+    lower_m2.push_back(0);
+    upper_counts.push_back(0);
+    upper_means.push_back(0);
+    upper_m2.push_back(0);
+    return k;
+}
@@ -0,0 +1,45 @@
+//
+//  Mutation_age_accumulator.hpp
+//  SINGER
+//
+
+#ifndef Mutation_age_accumulator_hpp
+#define Mutation_age_accumulator_hpp
+
+#include <stdio.h>
+#include <iomanip>
+#include "Accumulator.hpp"
+
+// running mean and variance of the lower and upper node ages of the branches each mutation is mapped to
+// every mapped branch is one observation, upper ages are left out when the branch ends at the root
+class Mutation_age_accumulator : public Accumulator {
+
+public:
+
+    vector<double> positions = {};
+    vector<int> lower_counts = {};
+    vector<double> lower_means = {};
+    vector<double> lower_m2 = {};
+    vector<int> upper_counts = {};
+    vector<double> upper_means = {};
+    vector<double> upper_m2 = {};
+    double Ne = 1;
+
+    string name() override;
+
+    void update(ARG &a) override;
+
+    void write(string prefix) override;
+
+    void write_state(vector<char> &buffer) override;
+
+    void read_state(const char *&p) override;
+
+private:
+
+    unordered_map<double, int> site_ids = {};
+
+    int site_id(double m);
+};
+
+#endif /* Mutation_age_accumulator_hpp */
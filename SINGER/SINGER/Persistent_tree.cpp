@@ -0,0 +1,225 @@
+//
+//  Persistent_tree.cpp
+//  SINGER
+//
+
+#include "Persistent_tree.hpp"
+
+Persistent_tree::Persistent_tree() {}
+
+Persistent_tree::Persistent_tree(Tree &tree, double cut_time) {
+    for (auto &x : tree.parents) {
+        internal_insert_branch(Branch(x.first, x.second), cut_time);
+    }
+}
+
+Persistent_tree::Persistent_tree(const Persistent_tree &other) : entries(other.entries), root(other.root), size(other.size) {
+    owned_from = (int) entries->size();
+    other.owned_from = owned_from;
+}
+
+Persistent_tree &Persistent_tree::operator=(const Persistent_tree &other) {
+    entries = other.entries;
+    root = other.root;
+    size = other.size;
+    // from now on both versions reach the same entries, so neither can change them in place
+    owned_from = (int) entries->size();
+    other.owned_from = owned_from;
+    return *this;
+}
+
+void Persistent_tree::internal_insert_branch(const Branch &b, double cut_time) {
+    if (b.upper_node->time <= cut_time) {
+        return;
+    }
+    Node_ptr parent = find_parent(b.lower_node);
+    if (parent == b.upper_node) {
+        return;
+    }
+    if (parent != nullptr) {
+        root = erase(root, b.lower_node);
+        size -= 1;
+    }
+    Tree_entry e = Tree_entry();
+    e.lower_node = b.lower_node;
+    e.upper_node = b.upper_node;
+    e.priority = get_priority(b.lower_node);
+    entries->push_back(e);
+    root = insert(root, (int) entries->size() - 1);
+    size += 1;
+}
+
+void Persistent_tree::internal_delete_branch(const Branch &b, double cut_time) {
+    if (b.upper_node->time <= cut_time or find_parent(b.lower_node) == nullptr) {
+        return;
+    }
+    root = erase(root, b.lower_node);
+    size -= 1;
+}
+
+void Persistent_tree::internal_forward_update(Recombination &r, double cut_time) {
+    for (const Branch &b : r.deleted_branches) {
+        internal_delete_branch(b, cut_time);
+    }
+    for (const Branch &b : r.inserted_branches) {
+        internal_insert_branch(b, cut_time);
+    }
+}
+
+void Persistent_tree::internal_backward_update(Recombination &r, double cut_time) {
+    for (const Branch &b : r.inserted_branches) {
+        internal_delete_branch(b, cut_time);
+    }
+    for (const Branch &b : r.deleted_branches) {
+        internal_insert_branch(b, cut_time);
+    }
+}
+
+Node_ptr Persistent_tree::find_parent(const Node_ptr &n) {
+    vector<Tree_entry> &pool = *entries;
+    int e = root;
+    while (e >= 0) {
+        if (less(n, pool[e].lower_node)) {
+            e = pool[e].left;
+        } else if (less(pool[e].lower_node, n)) {
+            e = pool[e].right;
+        } else {
+            return pool[e].upper_node;
+        }
+    }
+    return nullptr;
+}
+
+vector<Branch> Persistent_tree::get_branches() {
+    vector<Tree_entry> &pool = *entries;
+    vector<Branch> branches = {};
+    branches.reserve(size);
+    vector<int> stack = {};
+    int e = root;
+    while (e >= 0 or stack.size() > 0) {
+        while (e >= 0) {
+            stack.push_back(e);
+            e = pool[e].left;
+        }
+        e = stack.back();
+        stack.pop_back();
+        branches.push_back(Branch(pool[e].lower_node, pool[e].upper_node));
+        e = pool[e].right;
+    }
+    return branches;
+}
+
+// private methods:
+
+bool Persistent_tree::less(const Node_ptr &n1, const Node_ptr &n2) {
+    // same order as compare_node, without copying the pointers
+    if (n1->time != n2->time) {
+        return n1->time < n2->time;
+    }
+    return n1->index < n2->index;
+}
+
+uint64_t Persistent_tree::get_priority(const Node_ptr &n) {
+    // only the shape of the treap depends on it, the order of the entries is set by the nodes
+    uint64_t x = (uint64_t) n.get();
+    x += 0x9e3779b97f4a7c15;
+    x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27))*0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+int Persistent_tree::copy_entry(int e) {
+    if (e >= owned_from) {
+        return e;
+    }
+    entries->push_back((*entries)[e]);
+    return (int) entries->size() - 1;
+}
+
+int Persistent_tree::insert(int e, int new_e) {
+    vector<Tree_entry> &pool = *entries;
+    if (e < 0) {
+        return new_e;
+    }
+    if (pool[new_e].priority > pool[e].priority) {
+        int l = -1;
+        int r = -1;
+        Node_ptr n = pool[new_e].lower_node; // the pool can move while splitting
+        split(e, n, l, r);
+        (*entries)[new_e].left = l;
+        (*entries)[new_e].right = r;
+        return new_e;
+    }
+    bool go_left = less(pool[new_e].lower_node, pool[e].lower_node);
+    int c = copy_entry(e);
+    if (go_left) {
+        int l = insert((*entries)[c].left, new_e);
+        (*entries)[c].left = l;
+    } else {
+        int r = insert((*entries)[c].right, new_e);
+        (*entries)[c].right = r;
+    }
+    return c;
+}
+
+int Persistent_tree::erase(int e, const Node_ptr &n) {
+    vector<Tree_entry> &pool = *entries;
+    if (less(n, pool[e].lower_node)) {
+        int l = erase(pool[e].left, n);
+        int c = copy_entry(e);
+        (*entries)[c].left = l;
+        return c;
+    } else if (less(pool[e].lower_node, n)) {
+        int r = erase(pool[e].right, n);
+        int c = copy_entry(e);
+        (*entries)[c].right = r;
+        return c;
+    } else {
+        return merge(pool[e].left, pool[e].right);
+    }
+}
+
+void Persistent_tree::split(int e, const Node_ptr &n, int &l, int &r) {
+    // l gets the entries before n, r the entries after it (n itself is not in the tree)
+    if (e < 0) {
+        l = -1;
+        r = -1;
+        return;
+    }
+    int c = copy_entry(e);
+    if (less(n, (*entries)[c].lower_node)) {
+        int sub_l = -1;
+        int sub_r = -1;
+        split((*entries)[c].left, n, sub_l, sub_r);
+        (*entries)[c].left = sub_r;
+        l = sub_l;
+        r = c;
+    } else {
+        int sub_l = -1;
+        int sub_r = -1;
+        split((*entries)[c].right, n, sub_l, sub_r);
+        (*entries)[c].right = sub_l;
+        l = c;
+        r = sub_r;
+    }
+}
+
+int Persistent_tree::merge(int l, int r) {
+    if (l < 0) {
+        return r;
+    }
+    if (r < 0) {
+        return l;
+    }
+    if ((*entries)[l].priority > (*entries)[r].priority) {
+        int c = copy_entry(l);
+        int sub = merge((*entries)[c].right, r);
+        (*entries)[c].right = sub;
+        return c;
+    } else {
+        int c = copy_entry(r);
+        int sub = merge(l, (*entries)[c].left);
+        (*entries)[c].left = sub;
+        return c;
+    }
+}
@@ -0,0 +1,75 @@
+//
+//  Persistent_tree.hpp
+//  SINGER
+//
+
+#ifndef Persistent_tree_hpp
+#define Persistent_tree_hpp
+
+#include <stdio.h>
+#include "Tree.hpp"
+
+// one entry of the parent map, entries are never modified once another version can reach them
+struct Tree_entry {
+
+    Node_ptr lower_node = nullptr;
+    Node_ptr upper_node = nullptr;
+    uint64_t priority = 0;
+    int left = -1;
+    int right = -1;
+};
+
+// the parent map of a tree as a path-copying treap ordered like Tree::parents
+// a copy shares all entries with the original, and inserting or deleting a branch only copies the shared entries on one search path
+class Persistent_tree {
+
+public:
+
+    shared_ptr<vector<Tree_entry>> entries = make_shared<vector<Tree_entry>>(); // shared by all versions derived from one another
+    int root = -1;
+    int size = 0;
+
+    Persistent_tree();
+
+    Persistent_tree(Tree &tree, double cut_time); // the branches of tree above cut_time
+
+    Persistent_tree(const Persistent_tree &other);
+
+    Persistent_tree(Persistent_tree &&other) = default;
+
+    Persistent_tree &operator=(const Persistent_tree &other);
+
+    Persistent_tree &operator=(Persistent_tree &&other) = default;
+
+    void internal_insert_branch(const Branch &b, double cut_time);
+
+    void internal_delete_branch(const Branch &b, double cut_time);
+
+    void internal_forward_update(Recombination &r, double cut_time);
+
+    void internal_backward_update(Recombination &r, double cut_time);
+
+    Node_ptr find_parent(const Node_ptr &n); // nullptr when n has no branch
+
+    vector<Branch> get_branches(); // in the order of the lower nodes
+
+private:
+
+    mutable int owned_from = 0; // entries from here on were created by this version and are changed in place
+
+    bool less(const Node_ptr &n1, const Node_ptr &n2);
+
+    uint64_t get_priority(const Node_ptr &n);
+
+    int copy_entry(int e);
+
+    int insert(int e, int new_e);
+
+    int erase(int e, const Node_ptr &n);
+
+    void split(int e, const Node_ptr &n, int &l, int &r);
+
+    int merge(int l, int r);
+};
+
+#endif /* Persistent_tree_hpp */
@@ -0,0 +1,102 @@
+//
+//  Proposal_scheduler.cpp
+//  SINGER
+//
+
+#include "Proposal_scheduler.hpp"
+
+Proposal_scheduler::Proposal_scheduler() {}
+
+Proposal_scheduler::Proposal_scheduler(double sequence_length, int n) {
+    num_regions = n;
+    region_size = sequence_length/n;
+    proposed_lengths = vector<double>(n, 0);
+    accepted_lengths = vector<double>(n, 0);
+    unmapped_sites = vector<int>(n, 0);
+    weights = vector<double>(n, 1.0/n);
+}
+
+void Proposal_scheduler::update_weights(ARG &a) {
+    fill(unmapped_sites.begin(), unmapped_sites.end(), 0);
+    for (auto &x : a.mutation_branches) {
+        if (x.first >= a.sequence_length) {
+            break;
+        }
+        set<Branch> &branches = x.second;
+        bool to_root = branches.size() > 0 and branches.rbegin()->upper_node == a.root;
+        if (branches.size() > (to_root ? 2 : 1)) {
+            unmapped_sites[get_region(x.first)] += 1;
+        }
+    }
+    // acceptance starts from one region length accepted, so unvisited regions are not favoured for it
+    vector<double> scores(num_regions, 0);
+    double score_sum = 0;
+    for (int i = 0; i < num_regions; i++) {
+        double acceptance = (accepted_lengths[i] + region_size)/(proposed_lengths[i] + region_size);
+        scores[i] = (1 + unmapped_sites[i])*(1.1 - acceptance);
+        score_sum += scores[i];
+    }
+    for (int i = 0; i < num_regions; i++) {
+        weights[i] = uniform_share/num_regions + (1 - uniform_share)*scores[i]/score_sum;
+    }
+}
+
+double Proposal_scheduler::next_position(ARG &a) {
+    if (region >= 0 and a.end < min((region + 1)*region_size, a.sequence_length - 0.1)) {
+        return a.end;
+    }
+    double p = uniform_random();
+    region = num_regions - 1;
+    for (int i = 0; i < num_regions; i++) {
+        p -= weights[i];
+        if (p <= 0) {
+            region = i;
+            break;
+        }
+    }
+    // a sweep that spilled into the drawn region goes on from where it is, which keeps the tree at the cut
+    if (region == get_region(a.end) and a.end < a.sequence_length - 0.1) {
+        return a.end;
+    }
+    // the cuts of a sweep are at bin boundaries, so a jump goes to the start of a bin
+    double x = (region + uniform_random())*region_size;
+    return a.coordinates[a.get_index(min(x, a.sequence_length - 0.1))];
+}
+
+void Proposal_scheduler::record(double x, double y, bool accepted) {
+    for (int i = get_region(x); i < num_regions and i*region_size < y; i++) {
+        double l = min(y, (i + 1)*region_size) - max(x, i*region_size);
+        proposed_lengths[i] += l;
+        if (accepted) {
+            accepted_lengths[i] += l;
+        }
+    }
+}
+
+void Proposal_scheduler::write_state(vector<char> &buffer) {
+    put_value<int>(buffer, num_regions);
+    put_value<double>(buffer, region_size);
+    put_value<int>(buffer, region);
+    put_value<int>(buffer, burn_in);
+    put_vector(buffer, proposed_lengths);
+    put_vector(buffer, accepted_lengths);
+    put_vector(buffer, unmapped_sites);
+    put_vector(buffer, weights);
+}
+
+void Proposal_scheduler::read_state(const char *&p) {
+    num_regions = get_value<int>(p);
+    region_size = get_value<double>(p);
+    region = get_value<int>(p);
+    burn_in = get_value<int>(p);
+    proposed_lengths = get_vector<double>(p);
+    accepted_lengths = get_vector<double>(p);
+    unmapped_sites = get_vector<int>(p);
+    weights = get_vector<double>(p);
+}
+
+// private methods:
+
+int Proposal_scheduler::get_region(double x) {
+    return min((int) (x/region_size), num_regions - 1);
+}
@@ -0,0 +1,50 @@
+//
+//  Proposal_scheduler.hpp
+//  SINGER
+//
+
+#ifndef Proposal_scheduler_hpp
+#define Proposal_scheduler_hpp
+
+#include <stdio.h>
+#include "ARG.hpp"
+#include "Checkpoint.hpp"
+
+// cut positions for the MCMC: the cuts sweep along the sequence like without the scheduler, but when a sweep leaves its region
+// it jumps to a region drawn with weights that favour the regions with low acceptance and many sites not uniquely mapped
+// the weights are computed from the ARG, so a kernel that keeps adapting would not leave the posterior invariant: they are only
+// updated during burn-in and fixed afterwards, from then on the jumps follow the same distribution whatever the ARG is
+class Proposal_scheduler {
+
+public:
+
+    int num_regions = 20;
+    double region_size = 0;
+    double uniform_share = 0.5; // part of the weights spread evenly, so that every region keeps being visited
+    vector<double> proposed_lengths = {}; // length of the updated spans in each region, over all proposals
+    vector<double> accepted_lengths = {}; // the same for the accepted proposals
+    vector<int> unmapped_sites = {}; // sites not uniquely mapped in each region, counted at the start of the iteration
+    vector<double> weights = {};
+    int region = -1; // region of the current sweep
+    int burn_in = 0; // the weights are updated before this sample, the first half of the samples of the run that started the schedule
+
+    Proposal_scheduler();
+
+    Proposal_scheduler(double sequence_length, int n);
+
+    void update_weights(ARG &a);
+
+    double next_position(ARG &a); // where the next cut goes, given the end of the last update
+
+    void record(double x, double y, bool accepted);
+
+    void write_state(vector<char> &buffer);
+
+    void read_state(const char *&p);
+
+private:
+
+    int get_region(double x);
+};
+
+#endif /* Proposal_scheduler_hpp */
@@ -10,8 +10,8 @@
 Rate_map::Rate_map() {}
 
 void Rate_map::load_map(string mut_map_file) {
-    ifstream fin(mut_map_file);
-    if (!fin.good()) {
+    Text_reader fin = Text_reader();
+    if (!fin.open(mut_map_file)) {
         cerr << "input rate map file not found" << endl;
         exit(1);
     }
@@ -20,7 +20,7 @@ void Rate_map::load_map(string mut_map_file) {
     double right;
     double rate;
     double mut_dist;
-    while (fin >> left >> right >> rate) {
+    while (fin.read(left) and fin.read(right) and fin.read(rate)) {
         coordinates.push_back(left);
         mut_dist = rate_distances.back() + rate*(right - left);
         rate_distances.push_back(mut_dist);
@@ -50,6 +50,38 @@ double Rate_map::segment_distance(double x, double y) {
     return cumulative_distance(y) - cumulative_distance(x);
 }
 
+void Rate_map::reset_cursor() {
+    cursor = 0;
+}
+
+double Rate_map::cursor_distance(double x) {
+    // same as cumulative_distance, for queries that never move left between two resets
+    while (cursor + 2 < coordinates.size() and coordinates[cursor+1] <= x) {
+        cursor += 1;
+    }
+    double prev_dist = rate_distances[cursor];
+    double next_dist = rate_distances[cursor+1];
+    double p = (x - coordinates[cursor])/(coordinates[cursor+1] - coordinates[cursor]);
+    double dist = (1-p)*prev_dist + p*next_dist;
+    return dist;
+}
+
+vector<double> Rate_map::segment_distances(const vector<double> &x) {
+    // one pass over sorted points and the map breakpoints together
+    vector<double> distances = {};
+    if (x.size() < 2) {
+        return distances;
+    }
+    reset_cursor();
+    double prev_dist = cursor_distance(x[0]);
+    for (int i = 1; i < x.size(); i++) {
+        double next_dist = cursor_distance(x[i]);
+        distances.push_back(next_dist - prev_dist);
+        prev_dist = next_dist;
+    }
+    return distances;
+}
+
 double Rate_map::mean_rate() {
     double mr = rate_distances.back()/sequence_length;
     return mr;
@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 #include "Node.hpp"
+#include "Text_reader.hpp"
 
 class Rate_map {
     
@@ -18,6 +19,7 @@ public:
     double sequence_length = INT_MAX;
     vector<double> coordinates = {};
     vector<double> rate_distances = {};
+    int cursor = 0;
     
     Rate_map();
     
@@ -29,6 +31,12 @@ public:
     
     double segment_distance(double x, double y);
     
+    void reset_cursor();
+    
+    double cursor_distance(double x);
+    
+    vector<double> segment_distances(const vector<double> &x);
+    
     double mean_rate();
     
 };
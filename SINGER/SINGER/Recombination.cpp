@@ -11,8 +11,8 @@ Recombination::Recombination() {
 }
 
 Recombination::Recombination(set<Branch> db, set<Branch> ib) {
-    deleted_branches = db;
-    inserted_branches = ib;
+    deleted_branches = move(db);
+    inserted_branches = move(ib);
     simplify_branches();
     find_nodes();
 }
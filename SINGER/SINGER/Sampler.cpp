@@ -54,85 +54,25 @@ void Sampler::set_num_samples(int n) {
 
 void Sampler::naive_read_vcf(string prefix, double start_pos, double end_pos) {
     string vcf_file = prefix + ".vcf";
-    ifstream file(vcf_file);
-    string line;
-    int num_individuals = 0;
-    int prev_pos = -1;
+    Vcf_parser parser = Vcf_parser();
+    if (!parser.open(vcf_file)) {
+        cerr << "VCF file not found: " + vcf_file << endl;
+        exit(1);
+    }
     vector<Node_ptr> nodes = {};
+    nodes.resize(parser.num_haplotypes);
+    for (int i = 0; i < nodes.size(); i++) {
+        nodes[i] = new_node(0.0);
+        nodes[i]->set_index(i);
+        sample_nodes.insert(nodes[i]);
+    }
+    size_t begin = parser.find_position(start_pos, parser.body_start);
+    size_t end = parser.find_position(floor(end_pos) + 1, begin);
+    int following_pos = end < parser.size ? parser.read_position(end) : -1;
+    vector<Vcf_parser::Record> records = parser.parse(begin, end, num_threads);
     int valid_mutation = 0;
     int removed_mutation = 0;
-    vector<double> genotypes = {};
-    while (getline(file, line)) {
-        if (line.substr(0, 6) == "#CHROM") {
-            istringstream iss(line);
-            vector<string> fields;
-            string field;
-            while (iss >> field) {
-                fields.push_back(field);
-            }
-            num_individuals = (int) fields.size() - 9;
-            nodes.resize(2*num_individuals);
-            for (int i = 0; i < 2*num_individuals; i++) {
-                nodes[i] = new_node(0.0);
-                nodes[i]->set_index(i);
-                sample_nodes.insert(nodes[i]);
-            }
-            genotypes.resize(2*num_individuals);
-            continue;
-        } else if (line[0] == '#') {
-            continue; // skip these header lines
-        }
-        istringstream iss(line);
-        string chrom, id, ref, alt, qual, filter, info, format, genotype;
-        int pos;
-        iss >> chrom >> pos >> id >> ref >> alt >> qual >> filter >> info >> format;
-        
-        if (pos < start_pos) {continue;}
-        if (pos > end_pos) {break;}
-        if (pos == prev_pos) {continue;} // skip multi-allelic sites
-        if (ref.size() > 1 or alt.size() > 1) {
-            removed_mutation += 1;
-            continue;
-        } // skip multi-allelic sites or structural variant
-        
-        streampos old_pos = file.tellg();
-        string next_line;
-        if (getline(file, next_line)) {
-            istringstream next_iss(next_line);
-            string next_chrom;
-            int next_pos;
-            next_iss >> next_chrom >> next_pos;
-            if (next_pos == pos) {
-                removed_mutation += 1;
-                prev_pos = pos;
-                continue;
-            }
-            file.seekg(old_pos);
-        }
-        int individual_index = 0;
-        while (iss >> genotype) {
-            if (genotype[0] == '1') {
-                genotypes[2*individual_index] = 1;
-            } else {
-                genotypes[2*individual_index] = 0;
-            }
-            if (genotype[2] == '1') {
-                genotypes[2*individual_index + 1] = 1;
-            } else {
-                genotypes[2*individual_index + 1] = 0;
-            }
-            individual_index += 1;
-        }
-        int genotype_sum = accumulate(genotypes.begin(), genotypes.end(), 0.0);
-        if (genotype_sum >= 1 and genotype_sum < genotypes.size()) {
-            valid_mutation += 1;
-            for (int i = 0; i < genotypes.size(); i++) {
-                if (genotypes[i] == 1) {
-                    nodes[i]->add_mutation(pos - start_pos);
-                }
-            }
-        }
-    }
+    add_vcf_records(records, following_pos, nodes, start_pos, valid_mutation, removed_mutation);
     num_samples = (int) sample_nodes.size();
     ordered_sample_nodes = vector<Node_ptr>(sample_nodes.begin(), sample_nodes.end());
     shuffle(ordered_sample_nodes.begin(), ordered_sample_nodes.end(), random_engine);
@@ -166,84 +106,383 @@ void Sampler::guide_read_vcf(string prefix, double start, double end) {
         cerr << "Start position not found in index file: " + index_file << endl;
         exit(1);
     }
-    ifstream vcf_stream(vcf_file, ios::binary);
-    if (!vcf_stream.is_open()) {
+    Vcf_parser parser = Vcf_parser();
+    if (!parser.open(vcf_file)) {
         cerr << "VCF file not found: " + vcf_file << endl;
+        exit(1);
     }
-    vcf_stream.seekg(byte_offset, ios::beg);
-    int prev_pos = -1;
+    size_t begin = min((size_t) byte_offset, parser.size);
+    size_t end_offset = parser.find_position(end, begin);
+    int following_pos = end_offset < parser.size ? parser.read_position(end_offset) : -1;
+    vector<Vcf_parser::Record> records = parser.parse(begin, end_offset, num_threads);
     vector<Node_ptr> nodes = {};
     int valid_mutation = 0;
     int removed_mutation = 0;
-    vector<double> genotypes = {};
-    while (getline(vcf_stream, line)) {
-        istringstream iss(line);
-        string chrom, id, ref, alt, qual, filter, info, format, genotype;
-        int pos;
-        iss >> chrom >> pos >> id >> ref >> alt >> qual >> filter >> info >> format;
+    add_vcf_records(records, following_pos, nodes, start, valid_mutation, removed_mutation);
+    if (valid_mutation < 3) {
+        cerr << "there are too few variants in this region, algorithm not run" << endl;
+    }
+    num_samples = (int) sample_nodes.size();
+    ordered_sample_nodes = vector<Node_ptr>(sample_nodes.begin(), sample_nodes.end());
+    // shuffle(ordered_sample_nodes.begin(), ordered_sample_nodes.end(), random_engine);
+    sequence_length = end - start;
+    cout << "valid mutations: " << valid_mutation << endl;
+    cout << "removed mutations: " << removed_mutation << endl;
+}
+
+void Sampler::add_vcf_records(vector<Vcf_parser::Record> &records, int following_pos, vector<Node_ptr> &nodes, double start_pos, int &valid_mutation, int &removed_mutation) {
+    int prev_pos = -1;
+    vector<int> removed_positions = {};
+    vector<int> kept = filter_vcf_records(records, following_pos, prev_pos, removed_positions);
+    removed_mutation += removed_positions.size();
+    for (int i : kept) {
+        Vcf_parser::Record &record = records[i];
+        if (nodes.size() == 0) {
+            nodes.resize(record.num_haplotypes);
+            for (int j = 0; j < nodes.size(); j++) {
+                nodes[j] = new_node(0.0);
+                nodes[j]->set_index(j);
+                sample_nodes.insert(nodes[j]);
+            }
+        }
+        int genotype_sum = (int) record.carriers.size();
+        if (genotype_sum >= 1 and genotype_sum < nodes.size()) {
+            valid_mutation += 1;
+            for (int j : record.carriers) {
+                if (j < nodes.size()) {
+                    nodes[j]->add_mutation(record.pos - start_pos);
+                }
+            }
+        }
+    }
+}
+
+vector<int> Sampler::filter_vcf_records(vector<Vcf_parser::Record> &records, int following_pos, int &prev_pos, vector<int> &removed_positions) {
+    vector<int> kept = {};
+    for (int i = 0; i < records.size(); i++) {
+        Vcf_parser::Record &record = records[i];
+        int pos = record.pos;
         if (pos == prev_pos) {continue;} // skip multi-allelic sites
-        if (pos >= end) {break;} // variant out of scope
-        if (ref.size() > 1 or alt.size() > 1) {
-            removed_mutation += 1;
+        if (!record.snp) {
+            removed_positions.push_back(pos);
             continue;
         } // skip multi-allelic sites or structural variant
-        streampos old_pos = vcf_stream.tellg();
-        string next_line;
-        if (getline(vcf_stream, next_line)) {
-            istringstream next_iss(next_line);
-            string next_chrom;
-            int next_pos;
-            next_iss >> next_chrom >> next_pos;
-            if (next_pos == pos) {
-                removed_mutation += 1;
-                prev_pos = pos;
-                continue;
+        int next_pos = i + 1 < records.size() ? records[i + 1].pos : following_pos;
+        if (next_pos == pos) {
+            removed_positions.push_back(pos);
+            prev_pos = pos;
+            continue;
+        }
+        kept.push_back(i);
+    }
+    return kept;
+}
+
+vector<pair<double, uint64_t>> Sampler::index_bgzf(string vcf_file) {
+    // virtual offset of the first record in every bin of vcf_index_bin bases, cached next to the .vcf.gz or .bcf
+    string index_file = vcf_file + ".index";
+    ifstream vcf_stream(vcf_file, ios::binary|ios::ate);
+    long file_size = (long) vcf_stream.tellg();
+    vcf_stream.close();
+    long file_mtime = (long) modification_time(vcf_file);
+    vector<pair<double, uint64_t>> bins = {};
+    ifstream idx_stream(index_file);
+    string line;
+    if (idx_stream.is_open() and getline(idx_stream, line)) {
+        istringstream iss(line);
+        string tag;
+        long indexed_size = -1;
+        long indexed_mtime = -1;
+        double indexed_bin = -1;
+        iss >> tag >> indexed_size >> indexed_mtime >> indexed_bin;
+        if (tag == "#bgzf" and indexed_size == file_size and indexed_mtime == file_mtime and indexed_bin == vcf_index_bin) {
+            double bin_start;
+            uint64_t offset;
+            while (idx_stream >> bin_start >> offset) {
+                bins.push_back({bin_start, offset});
             }
-            vcf_stream.seekg(old_pos);
+            return bins;
+        }
+    }
+    cout << "Indexing " << vcf_file << endl;
+    auto add_record = [&](double pos, uint64_t offset) {
+        double bin_start = floor(pos/vcf_index_bin)*vcf_index_bin;
+        if (bins.size() == 0 or bins.back().first < bin_start) {
+            bins.push_back({bin_start, offset});
         }
-        int individual_index = 0;
-        while (iss >> genotype) {
-            if (genotypes.size() < 2*individual_index + 2) {
-                genotypes.resize(2*individual_index + 2);
+    };
+    if (vcf_file.size() > 4 and vcf_file.substr(vcf_file.size() - 4) == ".bcf") {
+        Bcf_reader bcf_reader = Bcf_reader();
+        bcf_reader.open(vcf_file);
+        Vcf_parser::Record record;
+        uint64_t offset = bcf_reader.reader.tell();
+        while (bcf_reader.read_record(record)) {
+            add_record(record.pos, offset);
+            offset = bcf_reader.reader.tell();
+        }
+    } else {
+        Bgzf_reader reader = Bgzf_reader();
+        reader.open(vcf_file);
+        uint64_t offset = reader.tell();
+        while (reader.getline(line)) {
+            if (line.size() > 0 and line[0] != '#') {
+                istringstream iss(line);
+                string chrom;
+                double pos;
+                iss >> chrom >> pos;
+                add_record(pos, offset);
             }
-            if (genotype[0] == '1') {
-                genotypes[2*individual_index] = 1;
-            } else {
-                genotypes[2*individual_index] = 0;
+            offset = reader.tell();
+        }
+    }
+    ofstream idx_out(index_file);
+    if (!idx_out) {
+        cerr << "Error opening the file: " << index_file << endl;
+        return bins;
+    }
+    // bin starts are written in full, a rounded one would make the lookup skip its bin
+    idx_out << setprecision(numeric_limits<double>::max_digits10);
+    idx_out << "#bgzf " << file_size << " " << file_mtime << " " << vcf_index_bin << "\n";
+    for (auto &x : bins) {
+        idx_out << x.first << " " << x.second << "\n";
+    }
+    return bins;
+}
+
+uint64_t Sampler::modification_time(string filename) {
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0) {
+        return 0;
+    }
+    return (uint64_t) st.st_mtime;
+}
+
+void Sampler::bgzf_read_vcf(string prefix, double start, double end) {
+    string vcf_file = prefix + ".vcf.gz";
+    vector<pair<double, uint64_t>> bins = index_bgzf(vcf_file);
+    Bgzf_reader reader = Bgzf_reader();
+    if (!reader.open(vcf_file)) {
+        cerr << "VCF file not found: " + vcf_file << endl;
+        exit(1);
+    }
+    double start_bin = floor(start/vcf_index_bin)*vcf_index_bin;
+    auto it = lower_bound(bins.begin(), bins.end(), make_pair(start_bin, (uint64_t) 0));
+    if (it == bins.end()) {
+        cerr << "there are too few variants in this region, algorithm not run" << endl;
+        exit(1);
+    }
+    reader.seek(it->second);
+    // same window as the plain .vcf, the record at end is included
+    Vcf_parser parser = Vcf_parser();
+    vector<Vcf_parser::Record> records = {};
+    Vcf_parser::Record record;
+    int following_pos = -1;
+    string line = "";
+    while (reader.getline(line)) {
+        if (line.size() == 0 or line[0] == '#') {continue;}
+        parser.parse_line(line.data(), line.data() + line.size(), record);
+        if (record.pos < start) {continue;}
+        if (record.pos > floor(end)) {
+            following_pos = record.pos;
+            break;
+        }
+        records.push_back(record);
+    }
+    vector<Node_ptr> nodes = {};
+    int valid_mutation = 0;
+    int removed_mutation = 0;
+    add_vcf_records(records, following_pos, nodes, start, valid_mutation, removed_mutation);
+    if (valid_mutation < 3) {
+        cerr << "there are too few variants in this region, algorithm not run" << endl;
+    }
+    num_samples = (int) sample_nodes.size();
+    ordered_sample_nodes = vector<Node_ptr>(sample_nodes.begin(), sample_nodes.end());
+    // shuffled from the same engine state as the plain .vcf, so both give the same threading order
+    shuffle(ordered_sample_nodes.begin(), ordered_sample_nodes.end(), random_engine);
+    sequence_length = end - start;
+    cout << "valid mutations: " << valid_mutation << endl;
+    cout << "removed mutations: " << removed_mutation << endl;
+}
+
+void Sampler::bcf_read_vcf(string prefix, double start, double end) {
+    string bcf_file = prefix + ".bcf";
+    Bcf_reader bcf_reader = Bcf_reader();
+    if (!bcf_reader.open(bcf_file)) {
+        cerr << "BCF file not found: " + bcf_file << endl;
+        exit(1);
+    }
+    if (bcf_reader.gt_key < 0) {
+        cerr << "no GT field in the BCF header: " + bcf_file << endl;
+        exit(1);
+    }
+    // seek with the CSI index from bcftools index if there is one, otherwise with our own cached index
+    uint64_t offset = bcf_reader.first_record;
+    if (ifstream(bcf_file + ".csi").good()) {
+        offset = bcf_reader.query_csi(bcf_file + ".csi", start);
+    } else {
+        vector<pair<double, uint64_t>> bins = index_bgzf(bcf_file);
+        double start_bin = floor(start/vcf_index_bin)*vcf_index_bin;
+        auto it = lower_bound(bins.begin(), bins.end(), make_pair(start_bin, (uint64_t) 0));
+        if (it == bins.end()) {
+            cerr << "there are too few variants in this region, algorithm not run" << endl;
+            exit(1);
+        }
+        offset = it->second;
+    }
+    bcf_reader.reader.seek(offset);
+    vector<Vcf_parser::Record> records = {};
+    Vcf_parser::Record record;
+    int following_pos = -1;
+    // same window as the plain .vcf, the record at end is included
+    while (bcf_reader.read_record(record)) {
+        if (record.pos < start) {continue;}
+        if (record.pos > floor(end)) {
+            following_pos = record.pos;
+            break;
+        }
+        records.push_back(record);
+    }
+    vector<Node_ptr> nodes = {};
+    int valid_mutation = 0;
+    int removed_mutation = 0;
+    add_vcf_records(records, following_pos, nodes, start, valid_mutation, removed_mutation);
+    if (valid_mutation < 3) {
+        cerr << "there are too few variants in this region, algorithm not run" << endl;
+    }
+    num_samples = (int) sample_nodes.size();
+    ordered_sample_nodes = vector<Node_ptr>(sample_nodes.begin(), sample_nodes.end());
+    shuffle(ordered_sample_nodes.begin(), ordered_sample_nodes.end(), random_engine);
+    sequence_length = end - start;
+    cout << "valid mutations: " << valid_mutation << endl;
+    cout << "removed mutations: " << removed_mutation << endl;
+}
+
+string Sampler::input_vcf_file(string prefix) {
+    for (string suffix : {".vcf", ".vcf.gz", ".bcf"}) {
+        if (ifstream(prefix + suffix).good()) {
+            return prefix + suffix;
+        }
+    }
+    return "";
+}
+
+void Sampler::prepare_genotypes(string prefix) {
+    string vcf_file = input_vcf_file(prefix);
+    if (vcf_file.size() == 0) {
+        cerr << "VCF file not found: " + prefix << endl;
+        exit(1);
+    }
+    ifstream vcf_stream(vcf_file, ios::binary|ios::ate);
+    uint64_t file_size = (uint64_t) vcf_stream.tellg();
+    vcf_stream.close();
+    // one reader per input format, all producing records in file order
+    Vcf_parser parser = Vcf_parser();
+    Bgzf_reader reader = Bgzf_reader();
+    Bcf_reader bcf_reader = Bcf_reader();
+    size_t offset = 0;
+    string line = "";
+    function<bool(Vcf_parser::Record &)> next_record;
+    if (vcf_file == prefix + ".vcf") {
+        parser.open(vcf_file);
+        offset = parser.body_start;
+        next_record = [&](Vcf_parser::Record &record) {
+            if (offset >= parser.size) {
+                return false;
             }
-            if (genotype[2] == '1') {
-                genotypes[2*individual_index + 1] = 1;
-            } else {
-                genotypes[2*individual_index + 1] = 0;
+            offset = parser.parse_record(offset, record);
+            return true;
+        };
+    } else if (vcf_file == prefix + ".vcf.gz") {
+        reader.open(vcf_file);
+        next_record = [&](Vcf_parser::Record &record) {
+            while (reader.getline(line)) {
+                if (line.size() > 0 and line[0] == '#') {
+                    parser.read_header_line(line.data(), line.data() + line.size());
+                } else if (line.size() > 0) {
+                    parser.parse_line(line.data(), line.data() + line.size(), record);
+                    return true;
+                }
             }
-            individual_index += 1;
+            return false;
+        };
+    } else {
+        bcf_reader.open(vcf_file);
+        parser.num_haplotypes = bcf_reader.num_haplotypes;
+        next_record = [&](Vcf_parser::Record &record) {
+            return bcf_reader.read_record(record);
+        };
+    }
+    Vcf_parser::Record next;
+    bool has_next = next_record(next);
+    Genotype_cache cache = Genotype_cache();
+    cache.start_write(prefix + ".sgt", parser.num_haplotypes, file_size, modification_time(vcf_file));
+    vector<Vcf_parser::Record> batch = {};
+    vector<int> removed_positions = {};
+    int prev_pos = -1;
+    while (has_next) {
+        batch.clear();
+        while (has_next and batch.size() < 65536) {
+            batch.push_back(move(next));
+            has_next = next_record(next);
         }
-        if (nodes.size() == 0) {
-            nodes.resize(genotypes.size());
-            for (int i = 0; i < nodes.size(); i++) {
-                nodes[i] = new_node(0.0);
-                nodes[i]->set_index(i);
-                sample_nodes.insert(nodes[i]);
+        int following_pos = has_next ? next.pos : -1;
+        removed_positions.clear();
+        vector<int> kept = filter_vcf_records(batch, following_pos, prev_pos, removed_positions);
+        for (int pos : removed_positions) {
+            cache.write_removed(pos);
+        }
+        for (int i : kept) {
+            int genotype_sum = (int) batch[i].carriers.size();
+            if (genotype_sum >= 1 and genotype_sum < parser.num_haplotypes) {
+                cache.write_site(batch[i].pos, batch[i].carriers);
+            } else {
+                cache.write_monomorphic();
             }
-        } else {
-            assert(nodes.size() == genotypes.size());
         }
-        int genotype_sum = accumulate(genotypes.begin(), genotypes.end(), 0.0);
-        if (genotype_sum >= 1 and genotype_sum < genotypes.size()) {
-            valid_mutation += 1;
-            for (int i = 0; i < genotypes.size(); i++) {
-                if (genotypes[i] == 1) {
-                    nodes[i]->add_mutation(pos - start);
-                }
+    }
+    cache.finish_write();
+    cout << "valid mutations: " << cache.num_sites << endl;
+    cout << "removed mutations: " << cache.num_removed << endl;
+    cout << "monomorphic sites: " << cache.num_monomorphic << endl;
+}
+
+void Sampler::cache_read_vcf(Genotype_cache &cache, double start, double end, bool guided) {
+    // guided: the window and sample order of guide_read_vcf, otherwise those of naive_read_vcf
+    if (guided) {
+        random_engine.seed(random_seed);
+    }
+    vector<Node_ptr> nodes = vector<Node_ptr>(cache.num_haplotypes);
+    for (int i = 0; i < nodes.size(); i++) {
+        nodes[i] = new_node(0.0);
+        nodes[i]->set_index(i);
+        sample_nodes.insert(nodes[i]);
+    }
+    size_t first = lower_bound(cache.positions, cache.positions + cache.num_sites, start) - cache.positions;
+    // the indexed .vcf stops before end, the plain .vcf includes the site at end
+    size_t last = guided ? lower_bound(cache.positions, cache.positions + cache.num_sites, end) - cache.positions : upper_bound(cache.positions, cache.positions + cache.num_sites, floor(end)) - cache.positions;
+    for (size_t i = first; i < last; i++) {
+        const uint64_t *row = cache.bits + i*cache.words_per_site;
+        double x = cache.positions[i] - start;
+        for (size_t w = 0; w < cache.words_per_site; w++) {
+            uint64_t word = row[w];
+            while (word != 0) {
+                int b = __builtin_ctzll(word);
+                nodes[64*w + b]->add_mutation(x);
+                word &= word - 1;
             }
         }
     }
+    int valid_mutation = (int) (last - first);
+    const int32_t *removed_end = guided ? lower_bound(cache.removed_positions, cache.removed_positions + cache.num_removed, end) : upper_bound(cache.removed_positions, cache.removed_positions + cache.num_removed, floor(end));
+    int removed_mutation = (int) (removed_end - lower_bound(cache.removed_positions, cache.removed_positions + cache.num_removed, start));
     if (valid_mutation < 3) {
         cerr << "there are too few variants in this region, algorithm not run" << endl;
     }
     num_samples = (int) sample_nodes.size();
     ordered_sample_nodes = vector<Node_ptr>(sample_nodes.begin(), sample_nodes.end());
-    // shuffle(ordered_sample_nodes.begin(), ordered_sample_nodes.end(), random_engine);
+    if (!guided) {
+        shuffle(ordered_sample_nodes.begin(), ordered_sample_nodes.end(), random_engine);
+    }
     sequence_length = end - start;
     cout << "valid mutations: " << valid_mutation << endl;
     cout << "removed mutations: " << removed_mutation << endl;
@@ -252,7 +491,25 @@ void Sampler::guide_read_vcf(string prefix, double start, double end) {
 void Sampler::load_vcf(string prefix, double start, double end) {
     string index_file = prefix + ".index";
     ifstream idx_stream(index_file);
-    if (idx_stream.is_open()) {
+    ifstream vcf_stream(prefix + ".vcf");
+    ifstream vcf_gz_stream(prefix + ".vcf.gz");
+    ifstream bcf_stream(prefix + ".bcf");
+    bool guided = idx_stream.is_open() and (vcf_stream.is_open() or (!vcf_gz_stream.is_open() and !bcf_stream.is_open()));
+    Genotype_cache cache = Genotype_cache();
+    if (cache.open(prefix + ".sgt")) {
+        string vcf_file = input_vcf_file(prefix);
+        ifstream source_stream(vcf_file, ios::binary|ios::ate);
+        if (vcf_file.size() == 0 or ((uint64_t) source_stream.tellg() == cache.source_size and modification_time(vcf_file) == cache.source_mtime)) {
+            cache_read_vcf(cache, start, end, guided);
+            return;
+        }
+        cerr << "genotype cache is out of date, reading " << vcf_file << " instead" << endl;
+    }
+    if (!vcf_stream.is_open() and vcf_gz_stream.is_open()) {
+        bgzf_read_vcf(prefix, start, end);
+    } else if (!vcf_stream.is_open() and bcf_stream.is_open()) {
+        bcf_read_vcf(prefix, start, end);
+    } else if (idx_stream.is_open()) {
         guide_read_vcf(prefix, start, end);
     } else {
         naive_read_vcf(prefix, start, end);
@@ -260,30 +517,88 @@ void Sampler::load_vcf(string prefix, double start, double end) {
 }
 
 void Sampler::optimal_ordering() {
+    // greedy: the next haplotype is the one with the fewest mutations not carried by any haplotype before it
+    // mutation sets are bit-packed rows, a count only changes when one of its mutations gets covered,
+    // and the heap keeps stale entries that are skipped when popped
+    vector<Node_ptr> nodes = vector<Node_ptr>(sample_nodes.begin(), sample_nodes.end());
+    int n = (int) nodes.size();
+    // site ids in order of first appearance, rows are filled in once the number of sites is known
+    unordered_map<double, int> site_ids = {};
+    vector<vector<int>> site_carriers = {};
+    for (int i = 0; i < n; i++) {
+        for (auto &x : nodes[i]->mutation_sites) {
+            if (x.first >= 0 and x.first < INT_MAX and x.second == 1) {
+                auto [it, inserted] = site_ids.try_emplace(x.first, (int) site_carriers.size());
+                if (inserted) {
+                    site_carriers.push_back({});
+                }
+                site_carriers[it->second].push_back(i);
+            }
+        }
+    }
+    size_t words = (site_carriers.size() + 63)/64;
+    vector<uint64_t> rows = vector<uint64_t>(n*words, 0);
+    for (int k = 0; k < site_carriers.size(); k++) {
+        for (int i : site_carriers[k]) {
+            rows[i*words + k/64] |= 1ULL << (k % 64);
+        }
+    }
+    vector<int> uncovered = vector<int>(n, 0);
+    priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> heap;
+    for (int i = 0; i < n; i++) {
+        for (size_t w = 0; w < words; w++) {
+            uncovered[i] += __builtin_popcountll(rows[i*words + w]);
+        }
+        heap.push({uncovered[i], i});
+    }
+    vector<uint64_t> covered = vector<uint64_t>(words, 0);
+    vector<bool> ordered = vector<bool>(n, false);
+    vector<int> stamps = vector<int>(n, -1);
+    vector<int> touched = {};
     ordered_sample_nodes.clear();
-    set<Node_ptr, compare_node> covered_nodes = {};
-    set<double> covered_mutations = {};
-    while (mutation_sets.size() > 0) {
-        cout << "Curr number of nodes: " << ordered_sample_nodes.size() << endl;
-        cout << "Number of covered mutations: " << covered_mutations.size() << endl;
-        auto it = min_element(mutation_sets.begin(), mutation_sets.end(), [](const auto& l, const auto& r) {return l.second.size() < r.second.size();});
-        Node_ptr n = it->first;
-        set<double> curr_mutations = it->second;
-        mutation_sets.erase(n);
-        for (auto &x : mutation_sets) {
-            for (double m : curr_mutations) {
-                x.second.erase(m);
+    while (heap.size() > 0) {
+        auto [count, i] = heap.top();
+        heap.pop();
+        if (ordered[i] or count != uncovered[i]) {
+            continue;
+        }
+        int step = (int) ordered_sample_nodes.size();
+        ordered[i] = true;
+        ordered_sample_nodes.push_back(nodes[i]);
+        touched.clear();
+        for (size_t w = 0; w < words; w++) {
+            uint64_t new_bits = rows[i*words + w] & ~covered[w];
+            covered[w] |= new_bits;
+            while (new_bits != 0) {
+                int b = __builtin_ctzll(new_bits);
+                for (int j : site_carriers[64*w + b]) {
+                    if (!ordered[j]) {
+                        uncovered[j] -= 1;
+                        if (stamps[j] != step) {
+                            stamps[j] = step;
+                            touched.push_back(j);
+                        }
+                    }
+                }
+                new_bits &= new_bits - 1;
             }
         }
-        for (double m : curr_mutations) {
-            covered_mutations.insert(m);
+        for (int j : touched) {
+            heap.push({uncovered[j], j});
         }
-        ordered_sample_nodes.push_back(n);
-        covered_nodes.insert(n);
     }
     cout << "Finished ordering" << endl;
 }
 
+void Sampler::order_samples() {
+    if (sample_ordering == "random") {
+        ordered_sample_nodes = vector<Node_ptr>(sample_nodes.begin(), sample_nodes.end());
+        shuffle(ordered_sample_nodes.begin(), ordered_sample_nodes.end(), random_engine);
+    } else if (sample_ordering == "greedy") {
+        optimal_ordering();
+    }
+}
+
 Node_ptr Sampler::build_node(int index, double time) {
     Node_ptr n = new_node(time);
     n->index = index;
@@ -304,6 +619,7 @@ void Sampler::build_singleton_arg() {
     bin_size = min(bin_size, 100.0);
     Node_ptr n = *ordered_sample_nodes.begin();
     arg = ARG(Ne, sequence_length);
+    arg.num_threads = num_threads;
     arg.discretize(bin_size);
     arg.build_singleton_arg(n);
     if (mut_rate > 0 and recomb_rate > 0) {
@@ -316,12 +632,14 @@ void Sampler::build_singleton_arg() {
 void Sampler::build_void_arg() {
     double bin_size = rho_unit/recomb_rate;
     arg = ARG(Ne, sequence_length);
+    arg.num_threads = num_threads;
     arg.discretize(bin_size);
     arg.compute_rhos_thetas(recomb_rate, mut_rate);
 }
 
 void Sampler::iterative_start() {
     start_log();
+    order_samples();
     build_singleton_arg();
     auto it = ordered_sample_nodes.begin();
     it++;
@@ -351,8 +669,50 @@ void Sampler::iterative_start() {
     arg.write_coordinates(coord_file);
 }
 
+void Sampler::incremental_start(string prefix) {
+    start_log();
+    load_saved_arg(prefix);
+    int num_saved = (int) arg.sample_nodes.size();
+    if (num_saved >= num_samples) {
+        cerr << "The input has no haplotypes beyond the " << num_saved << " in the saved ARG" << endl;
+        exit(1);
+    }
+    // the saved ARG holds the first haplotypes of the input, only the ones after them are threaded
+    check_saved_samples(num_saved);
+    order_samples();
+    for (Node_ptr n : ordered_sample_nodes) {
+        if (n->index < num_saved) {
+            continue;
+        }
+        random_engine.seed(random_seed);
+        Threader_smc threader = Threader_smc(bsp_c, tsp_q);
+        threader.pe->penalty = penalty;
+        threader.pe->ancestral_prob = polar;
+        if (fast_mode and arg.sample_nodes.size() > 1) {
+            threader.fast_thread(arg, n);
+        } else {
+            threader.thread(arg, n);
+        }
+        arg.check_incompatibility();
+        cout << "Number of flippings: " << arg.count_flipping() << endl;
+        random_seed = random_engine();
+        write_iterative_start();
+    }
+    cout << "orignal ARG length: " << arg.get_arg_length() << endl;
+    rescale();
+    cout << "rescaled ARG length: " << arg.get_arg_length() << endl;
+    string node_file = output_prefix + "_start_nodes_" + to_string(sample_index) + ".txt";
+    string branch_file= output_prefix + "_start_branches_" + to_string(sample_index) + ".txt";
+    string recomb_file = output_prefix + "_start_recombs_" + to_string(sample_index) + ".txt";
+    string mut_file = output_prefix + "_start_muts_" + to_string(sample_index) + ".txt";
+    arg.write(node_file, branch_file, recomb_file, mut_file);
+    string coord_file = output_prefix + "_coordinates.txt";
+    arg.write_coordinates(coord_file);
+}
+
 void Sampler::fast_iterative_start() {
     start_log();
+    order_samples();
     build_singleton_arg();
     auto it = ordered_sample_nodes.begin();
     it++;
@@ -541,30 +901,25 @@ void Sampler::internal_sample(int num_iters, int spacing) {
         double updated_length = 0;
         cout << "Random seed: " << random_seed << endl;
         random_engine.seed(random_seed);
-        while (updated_length < spacing*arg.sequence_length) {
-            Threader_smc threader = Threader_smc(bsp_c, tsp_q);
-            threader.pe->penalty = penalty;
-            threader.pe->ancestral_prob = polar;
-            tuple<double, Branch, double> cut_point = arg.sample_internal_cut();
+        Threader_smc threader = Threader_smc(bsp_c, tsp_q);
+        threader.pe->penalty = penalty;
+        threader.pe->ancestral_prob = polar;
+        threader.max_memory = hmm_memory;
+        start_schedule(num_iters);
+        while (updated_length < spacing*target_length()) {
+            threader.reset();
+            tuple<double, Branch, double> cut_point = next_cut_point();
             threader.internal_rethread(arg, cut_point);
-            updated_length += arg.coordinates[threader.end_index] - arg.coordinates[threader.start_index];
+            updated_length += count_update(threader);
             arg.clear_remove_info();
         }
         // normalize();
-        rescale();
-        random_seed = random_engine();
-        write_sample();
-        arg.check_incompatibility();
-        cout << "Start: " << arg.start << " , End: " << arg.end << endl;
-        string node_file = output_prefix + "_nodes_" + to_string(sample_index) + ".txt";
-        string branch_file= output_prefix + "_branches_" + to_string(sample_index) + ".txt";
-        string recomb_file = output_prefix + "_recombs_" + to_string(sample_index) + ".txt";
-        string mut_file = output_prefix + "_muts_" + to_string(sample_index) + ".txt";
-        sample_index += 1;
-        arg.write(node_file, branch_file, recomb_file, mut_file);
-        cout << "Number of trees: " << arg.recombinations.size() << endl;
-        cout << "Number of flippings: " << arg.count_flipping() << endl;
+        if (finish_iteration(output_prefix)) {
+            cout << "Target ESS reached after " << sample_index << " samples" << endl;
+            break;
+        }
     }
+    write_accumulators(output_prefix);
 }
 
 void Sampler::fast_internal_sample(int num_iters, int spacing) {
@@ -573,36 +928,121 @@ void Sampler::fast_internal_sample(int num_iters, int spacing) {
         double updated_length = 0;
         cout << "Random seed: " << random_seed << endl;
         random_engine.seed(random_seed);
-        while (updated_length < spacing*arg.sequence_length) {
-            Threader_smc threader = Threader_smc(bsp_c, tsp_q);
-            threader.pe->penalty = penalty;
-            threader.pe->ancestral_prob = polar;
-            tuple<double, Branch, double> cut_point = arg.sample_internal_cut();
+        Threader_smc threader = Threader_smc(bsp_c, tsp_q);
+        threader.pe->penalty = penalty;
+        threader.pe->ancestral_prob = polar;
+        threader.max_memory = hmm_memory;
+        start_schedule(num_iters);
+        while (updated_length < spacing*target_length()) {
+            threader.reset();
+            tuple<double, Branch, double> cut_point = next_cut_point();
             threader.fast_internal_rethread(arg, cut_point);
-            updated_length += arg.coordinates[threader.end_index] - arg.coordinates[threader.start_index];
+            updated_length += count_update(threader);
             arg.clear_remove_info();
         }
         // normalize();
-        rescale();
-        random_seed = random_engine();
-        write_sample();
-        arg.check_incompatibility();
-        cout << "Start: " << arg.start << " , End: " << arg.end << endl;
-        string node_file = output_prefix + "_fast_nodes_" + to_string(sample_index) + ".txt";
-        string branch_file= output_prefix + "_fast_branches_" + to_string(sample_index) + ".txt";
-        string recomb_file = output_prefix + "_fast_recombs_" + to_string(sample_index) + ".txt";
-        string mut_file = output_prefix + "_fast_muts_" + to_string(sample_index) + ".txt";
-        sample_index += 1;
-        arg.write(node_file, branch_file, recomb_file, mut_file);
-        cout << "Number of trees: " << arg.recombinations.size() << endl;
-        cout << "Number of flippings: " << arg.count_flipping() << endl;
+        if (finish_iteration(output_prefix + "_fast")) {
+            cout << "Target ESS reached after " << sample_index << " samples" << endl;
+            break;
+        }
     }
+    write_accumulators(output_prefix + "_fast");
 }
 
-void Sampler::resume_internal_sample(int num_iters, int spacing) {
-    string log_file = output_prefix + ".log";
-    read_resume_point(log_file);
+void Sampler::start_schedule(int num_iters) {
+    if (!adaptive_schedule) {
+        return;
+    }
+    if (scheduler.weights.size() == 0) {
+        scheduler = Proposal_scheduler(arg.sequence_length, scheduler.num_regions);
+        scheduler.burn_in = num_iters/2;
+    }
+    if (sample_index < scheduler.burn_in) {
+        scheduler.update_weights(arg);
+    }
+}
+
+double Sampler::target_length() {
+    // with a focus only the part of each update inside it counts towards the thinning
+    return focus_end > focus_start ? focus_end - focus_start : arg.sequence_length;
+}
+
+tuple<double, Branch, double> Sampler::next_cut_point() {
+    if (focus_end > focus_start) {
+        return arg.sample_internal_cut(next_focus_position());
+    } else if (adaptive_schedule) {
+        return arg.sample_internal_cut(scheduler.next_position(arg));
+    }
+    return arg.sample_internal_cut();
+}
+
+double Sampler::count_update(Threader_smc &threader) {
+    double x = arg.coordinates[threader.start_index];
+    double y = arg.coordinates[threader.end_index];
+    if (adaptive_schedule) {
+        scheduler.record(x, y, threader.accepted);
+    }
+    if (focus_end > focus_start) {
+        return min(y, focus_end) - max(x, focus_start);
+    }
+    return y - x;
+}
+
+double Sampler::next_focus_position() {
+    // the updates sweep along the focus and start over from its left end once they leave it
+    if (arg.end > focus_start and arg.end < focus_end and arg.end < arg.sequence_length - 0.1) {
+        return arg.end;
+    }
+    return focus_start;
+}
+
+bool Sampler::finish_iteration(string prefix) {
+    // rescaling fixes the ARG length by the number of mutations, so the trace uses the length before it
+    double arg_length = diagnostics_output ? arg.get_arg_length() : 0;
+    rescale();
+    random_seed = random_engine();
+    write_sample();
+    arg.check_incompatibility();
+    cout << "Start: " << arg.start << " , End: " << arg.end << endl;
+    string node_file = prefix + "_nodes_" + to_string(sample_index) + ".txt";
+    string branch_file= prefix + "_branches_" + to_string(sample_index) + ".txt";
+    string recomb_file = prefix + "_recombs_" + to_string(sample_index) + ".txt";
+    string mut_file = prefix + "_muts_" + to_string(sample_index) + ".txt";
+    string trees_file = prefix + "_" + to_string(sample_index) + ".trees";
     sample_index += 1;
+    update_accumulators();
+    bool converged = diagnostics_output and update_diagnostics(arg_length);
+    if (sample_output) {
+        if (archive_output) {
+            write_archive(prefix + ".arga");
+        } else {
+            arg.write(node_file, branch_file, recomb_file, mut_file);
+        }
+        if (tskit_output) {
+            arg.write_trees(trees_file);
+        }
+        if (coalescence_output) {
+            write_coalescence_times(prefix + "_coal_" + to_string(sample_index - 1) + ".csv");
+        }
+    }
+    write_checkpoint();
+    cout << "Number of trees: " << arg.recombinations.size() << endl;
+    cout << "Number of flippings: " << arg.count_flipping() << endl;
+    return converged;
+}
+
+void Sampler::resume_internal_sample(int num_iters, int spacing) {
+    if (!read_checkpoint()) {
+        string log_file = output_prefix + ".log";
+        read_resume_point(log_file);
+        sample_index += 1;
+    }
+    if (archive_output) {
+        archive.open_write(output_prefix + ".arga", arg.Ne, arg.sequence_length, true);
+    }
+    if (diagnostics_output) {
+        load_diagnostics();
+    }
     arg.check_incompatibility();
     cout << "Number of trees: " << arg.recombinations.size() << endl;
     cout << "Number of flippings: " << arg.count_flipping() << endl;
@@ -669,9 +1109,17 @@ void Sampler::resume_fast_internal_sample(int num_iters, int spacing) {
  */
 
 void Sampler::resume_fast_internal_sample(int num_iters, int spacing) {
-    string log_file = output_prefix + ".log";
-    read_resume_point(log_file);
-    sample_index += 1;
+    if (!read_checkpoint()) {
+        string log_file = output_prefix + ".log";
+        read_resume_point(log_file);
+        sample_index += 1;
+    }
+    if (archive_output) {
+        archive.open_write(output_prefix + "_fast.arga", arg.Ne, arg.sequence_length, true);
+    }
+    if (diagnostics_output) {
+        load_diagnostics();
+    }
     arg.check_incompatibility();
     cout << "Number of trees: " << arg.recombinations.size() << endl;
     cout << "Number of flippings: " << arg.count_flipping() << endl;
@@ -779,6 +1227,7 @@ void Sampler::write_cut(tuple<double, Branch, double> cut_point) {
 
 void Sampler::load_resume_arg() {
     arg = ARG(Ne, sequence_length);
+    arg.num_threads = num_threads;
     string node_file, branch_file, recomb_file, mut_file, coord_file;
     node_file = output_prefix + "_nodes_" + to_string(sample_index) + ".txt";
     branch_file= output_prefix + "_branches_" + to_string(sample_index) + ".txt";
@@ -794,6 +1243,92 @@ void Sampler::load_resume_arg() {
     }
 }
 
+void Sampler::load_saved_arg(string prefix) {
+    // from the checkpoint of that run when there is one, otherwise from the text files of the last sample in its log
+    arg = ARG(Ne, sequence_length);
+    arg.num_threads = num_threads;
+    vector<char> buffer = {};
+    if (read_checkpoint_file(prefix + ".ckpt", buffer)) {
+        const char *p = buffer.data();
+        for (int i = 0; i < 4; i++) {
+            get_value<int>(p); // sample index, random seed and counters of that run
+        }
+        arg.read_checkpoint(p);
+    } else {
+        vector<string> words = read_last_line(prefix + ".log");
+        if (words.size() < 3) {
+            cerr << "No saved ARG found in " << prefix + ".log" << endl;
+            exit(1);
+        }
+        string arg_prefix = words[2] == "initial_thread" ? prefix + "_start" : prefix;
+        string index = words[2] == "initial_thread" ? "0" : words[1];
+        arg.read(arg_prefix + "_nodes_" + index + ".txt", arg_prefix + "_branches_" + index + ".txt", arg_prefix + "_recombs_" + index + ".txt", arg_prefix + "_muts_" + index + ".txt");
+        arg.read_coordinates(prefix + "_coordinates.txt");
+        if (mut_rate > 0 and recomb_rate > 0) {
+            arg.compute_rhos_thetas(recomb_rate, mut_rate);
+        } else {
+            arg.compute_rhos_thetas(recomb_map, mut_map);
+        }
+    }
+    if (abs(arg.sequence_length - sequence_length) > 0.1) {
+        cerr << "The saved ARG has length " << arg.sequence_length << ", the input has length " << sequence_length << endl;
+        exit(1);
+    }
+    arg.sequence_length = sequence_length;
+}
+
+void Sampler::check_saved_samples(int num_saved) {
+    map<int, Node_ptr> saved_nodes = {};
+    map<int, Node_ptr> input_nodes = {};
+    for (Node_ptr n : arg.sample_nodes) {
+        saved_nodes[n->index] = n;
+    }
+    for (Node_ptr n : sample_nodes) {
+        if (n->index < num_saved) {
+            input_nodes[n->index] = n;
+        }
+    }
+    set<double> sites = {};
+    for (auto &x : input_nodes) {
+        for (auto &y : x.second->mutation_sites) {
+            if (y.first >= 0 and y.first < sequence_length) {
+                sites.insert(y.first);
+            }
+        }
+    }
+    for (double x : arg.mutation_sites) {
+        if (x < sequence_length) {
+            sites.insert(x);
+        }
+    }
+    set<double> new_sites = {};
+    for (double x : sites) {
+        bool saved_site = arg.mutation_sites.count(x) > 0;
+        for (auto &y : input_nodes) {
+            if (saved_nodes.count(y.first) == 0) {
+                cerr << "Haplotype " << y.first << " is missing from the saved ARG" << endl;
+                exit(1);
+            }
+            Node_ptr n = saved_nodes.at(y.first);
+            double s = y.second->get_state(x);
+            if (n->get_state(x) == s) {
+                continue;
+            }
+            if (saved_site) {
+                cerr << "Haplotype " << y.first << " of the input differs from the saved ARG at position " << x + start << endl;
+                exit(1);
+            }
+            // dropped in the earlier run because all of its haplotypes were derived
+            n->write_state(x, s);
+            new_sites.insert(x);
+        }
+    }
+    for (double x : new_sites) {
+        arg.map_site(x);
+    }
+    cout << "Sites added to the saved ARG: " << new_sites.size() << endl;
+}
+
 vector<string> Sampler::read_last_line(string filename) {
     ifstream file(filename, ios::in);
     vector<string> words;
@@ -845,6 +1380,107 @@ void Sampler::read_resume_point(string filename) {
     arg.end_tree = arg.get_tree_at(arg.end);
 }
 
+void Sampler::write_checkpoint() {
+    // random_seed is already the seed of the next iteration, which reseeds the engine before drawing anything
+    vector<char> buffer = {};
+    put_value<int>(buffer, sample_index);
+    put_value<int>(buffer, random_seed);
+    put_value<int>(buffer, TSP::counter);
+    put_value<int>(buffer, TSP_smc::counter);
+    arg.write_checkpoint(buffer);
+    for (auto &acc : accumulators) {
+        vector<char> state = {};
+        acc->write_state(state);
+        put_section(buffer, acc->name(), state);
+    }
+    if (adaptive_schedule) {
+        vector<char> state = {};
+        scheduler.write_state(state);
+        put_section(buffer, "schedule", state);
+    }
+    write_checkpoint_file(output_prefix + ".ckpt", buffer);
+}
+
+void Sampler::write_archive(string filename) {
+    if (!archive.is_open()) {
+        archive.open_write(filename, arg.Ne, arg.sequence_length, false);
+    }
+    archive.add_sample(arg, sample_index - 1);
+}
+
+void Sampler::write_coalescence_times(string filename) {
+    Coalescence_times ct = Coalescence_times(coalescence_window, coalescence_focal);
+    ct.compute(arg);
+    ct.write(filename);
+}
+
+void Sampler::update_accumulators() {
+    for (auto &acc : accumulators) {
+        acc->update(arg);
+    }
+}
+
+void Sampler::write_accumulators(string prefix) {
+    for (auto &acc : accumulators) {
+        acc->write(prefix);
+    }
+}
+
+bool Sampler::update_diagnostics(double arg_length) {
+    string filename = output_prefix + "_trace.txt";
+    diagnostics.add(sample_index - 1, arg_length, arg);
+    if (diagnostics.indices.size() == 1) {
+        diagnostics.write_trace(filename);
+    } else {
+        diagnostics.append_trace(filename);
+    }
+    diagnostics.compute();
+    for (int s = 0; s < diagnostics.names.size(); s++) {
+        cout << diagnostics.names[s] << " ESS: " << diagnostics.ess[s] << " , R-hat: " << diagnostics.rhat[s] << endl;
+    }
+    return target_ess > 0 and diagnostics.reached(target_ess);
+}
+
+void Sampler::load_diagnostics() {
+    // rows past the resumed sample were written after the checkpoint and are sampled again
+    string filename = output_prefix + "_trace.txt";
+    diagnostics.read_trace(filename, sample_index);
+    diagnostics.write_trace(filename);
+}
+
+bool Sampler::read_checkpoint() {
+    vector<char> buffer = {};
+    if (!read_checkpoint_file(output_prefix + ".ckpt", buffer)) {
+        return false;
+    }
+    const char *p = buffer.data();
+    sample_index = get_value<int>(p);
+    random_seed = get_value<int>(p);
+    TSP::counter = get_value<int>(p);
+    TSP_smc::counter = get_value<int>(p);
+    arg = ARG(Ne, sequence_length);
+    arg.num_threads = num_threads;
+    arg.read_checkpoint(p);
+    arg.end_tree = arg.get_tree_at(arg.end);
+    // every enabled summary found in the checkpoint continues, the others start from this sample
+    map<string, vector<char>> sections = get_sections(p, buffer.data() + buffer.size());
+    for (auto &acc : accumulators) {
+        auto it = sections.find(acc->name());
+        if (it == sections.end()) {
+            cerr << "Summary " << acc->name() << " is not in the checkpoint, starting it from sample " << sample_index << endl;
+            continue;
+        }
+        const char *q = it->second.data();
+        acc->read_state(q);
+    }
+    auto schedule_it = sections.find("schedule");
+    if (adaptive_schedule and schedule_it != sections.end()) {
+        const char *q = schedule_it->second.data();
+        scheduler.read_state(q);
+    }
+    return true;
+}
+
 /*
 void Sampler::retract_log(int k) {
     const std::string file_path = output_prefix + ".log";
@@ -11,6 +11,8 @@
 #include <stdio.h>
 #include <chrono>
 #include <sstream>
+#include <functional>
+#include <queue>
 #include "ARG.hpp"
 #include "Threader_smc.hpp"
 #include "Binary_emission.hpp"
@@ -18,6 +20,17 @@
 #include "Normalizer.hpp"
 #include "Scaler.hpp"
 #include "Rate_map.hpp"
+#include "Bgzf_reader.hpp"
+#include "Vcf_parser.hpp"
+#include "Bcf_reader.hpp"
+#include "Genotype_cache.hpp"
+#include "ARG_archive.hpp"
+#include "Coalescence_times.hpp"
+#include "Mutation_age_accumulator.hpp"
+#include "Coalescence_accumulator.hpp"
+#include "Diversity_accumulator.hpp"
+#include "Convergence_diagnostics.hpp"
+#include "Proposal_scheduler.hpp"
 
 class Sampler {
     
@@ -38,12 +51,31 @@ public:
     int num_samples = 0;
     ARG arg;
     bool fast_mode = false;
+    bool tskit_output = false;
+    bool archive_output = false;
+    ARG_archive archive;
+    bool coalescence_output = false;
+    int coalescence_focal = -1;
+    double coalescence_window = 10000;
+    bool sample_output = true;
+    vector<shared_ptr<Accumulator>> accumulators = {};
+    bool diagnostics_output = false;
+    double target_ess = 0;
+    Convergence_diagnostics diagnostics;
+    bool adaptive_schedule = false;
+    Proposal_scheduler scheduler;
+    double focus_start = 0; // internal updates are only started inside [focus_start, focus_end) when it is not empty
+    double focus_end = 0;
     double bsp_c = 0.01;
     double tsp_q = 0.05;
     int random_seed = 0;
     double penalty = 0.01;
+    double vcf_index_bin = 16384;
+    int num_threads = 1;
+    size_t hmm_memory = 256 << 20; // bytes of forward probabilities each HMM keeps between the rethreads of an iteration
     double polar = 0.99;
     int sample_index = 0;
+    string sample_ordering = "input"; // order of threading in iterative_start: input, random or greedy
     set<Node_ptr, compare_node> sample_nodes = {};
     vector<Node_ptr> ordered_sample_nodes = {};
     unordered_map<double, set<Node_ptr>> carriers = {};
@@ -73,10 +105,30 @@ public:
     
     void guide_read_vcf(string prefix, double start, double end);
     
+    void add_vcf_records(vector<Vcf_parser::Record> &records, int following_pos, vector<Node_ptr> &nodes, double start_pos, int &valid_mutation, int &removed_mutation);
+    
+    vector<int> filter_vcf_records(vector<Vcf_parser::Record> &records, int following_pos, int &prev_pos, vector<int> &removed_positions);
+    
+    uint64_t modification_time(string filename);
+    
+    vector<pair<double, uint64_t>> index_bgzf(string vcf_file);
+    
+    void bgzf_read_vcf(string prefix, double start, double end);
+    
+    void bcf_read_vcf(string prefix, double start, double end);
+    
+    string input_vcf_file(string prefix);
+    
+    void prepare_genotypes(string prefix);
+    
+    void cache_read_vcf(Genotype_cache &cache, double start, double end, bool guided);
+    
     void load_vcf(string prefix, double start, double end);
     
     void optimal_ordering();
     
+    void order_samples();
+    
     Node_ptr build_node(int index, double time);
     
     void build_all_nodes();
@@ -89,6 +141,8 @@ public:
     
     void fast_iterative_start();
     
+    void incremental_start(string prefix);
+    
     // void recombination_climb(int num_iters, int spacing);
     
     // void mutation_climb(int num_iters, int spacing);
@@ -105,6 +159,18 @@ public:
     
     void fast_internal_sample(int num_iters, int spacing);
     
+    void start_schedule(int num_iters);
+    
+    double target_length();
+    
+    tuple<double, Branch, double> next_cut_point();
+    
+    double count_update(Threader_smc &threader);
+    
+    double next_focus_position();
+    
+    bool finish_iteration(string prefix);
+    
     void resume_internal_sample(int num_iters, int spacing);
     
     void debug_resume_internal_sample(int num_iters, int spacing);
@@ -127,10 +193,30 @@ public:
     
     void load_resume_arg();
     
+    void load_saved_arg(string prefix);
+    
+    void check_saved_samples(int num_saved);
+    
     vector<string> read_last_line(string filename);
     
     void read_resume_point(string filename);
     
+    void write_checkpoint();
+    
+    void write_archive(string filename);
+    
+    void write_coalescence_times(string filename);
+    
+    void update_accumulators();
+    
+    void write_accumulators(string prefix);
+    
+    bool update_diagnostics(double arg_length);
+    
+    void load_diagnostics();
+    
+    bool read_checkpoint();
+    
     void retract_log(int k);
 };
 
@@ -0,0 +1,148 @@
+//
+//  Score_table.cpp
+//  SINGER
+//
+
+#include "Score_table.hpp"
+
+Score_table::iterator::iterator(Score_table *t, int i) {
+    table = t;
+    e = i;
+    while (e < table->entries.size() and !table->live[e]) {
+        e += 1;
+    }
+}
+
+pair<Interval_info, double> &Score_table::iterator::operator*() {
+    return table->entries[e];
+}
+
+Score_table::iterator &Score_table::iterator::operator++() {
+    e += 1;
+    while (e < table->entries.size() and !table->live[e]) {
+        e += 1;
+    }
+    return *this;
+}
+
+bool Score_table::iterator::operator!=(const iterator &other) const {
+    return e != other.e;
+}
+
+Score_table::Score_table() {}
+
+int Score_table::size() {
+    return num_live;
+}
+
+void Score_table::clear() {
+    entries.clear();
+    live.clear();
+    hashes.clear();
+    fill(slots.begin(), slots.end(), -1);
+    num_live = 0;
+}
+
+double &Score_table::operator[](const Interval_info &interval) {
+    uint64_t h = get_hash(interval);
+    if (slots.size() > 0) {
+        int s = find(interval, h);
+        if (slots[s] >= 0) {
+            return entries[slots[s]].second;
+        }
+    }
+    if (2*(entries.size() + 1) > slots.size()) {
+        rebuild();
+    }
+    int s = find(interval, h);
+    slots[s] = (int) entries.size();
+    entries.push_back({interval, 0});
+    live.push_back(true);
+    hashes.push_back(h);
+    num_live += 1;
+    return entries.back().second;
+}
+
+void Score_table::erase(const Interval_info &interval) {
+    if (slots.size() == 0) {
+        return;
+    }
+    int s = find(interval, get_hash(interval));
+    if (slots[s] >= 0) {
+        // the slot keeps pointing to the dead entry, so that the probes passing it are not cut short
+        live[slots[s]] = false;
+        num_live -= 1;
+    }
+}
+
+Score_table::iterator Score_table::begin() {
+    return iterator(this, 0);
+}
+
+Score_table::iterator Score_table::end() {
+    return iterator(this, (int) entries.size());
+}
+
+// private methods:
+
+uint64_t Score_table::get_hash(const Interval_info &interval) {
+    uint64_t h = 0;
+    uint64_t x = 0;
+    double values[3] = {interval.lb, interval.ub, interval.seed_pos};
+    uint64_t keys[5] = {(uint64_t) interval.branch.lower_node.get(), (uint64_t) interval.branch.upper_node.get(), 0, 0, 0};
+    for (int i = 0; i < 3; i++) {
+        double v = values[i] == 0 ? 0 : values[i]; // -0 and 0 are equal
+        memcpy(&keys[i + 2], &v, sizeof(double));
+    }
+    for (uint64_t k : keys) {
+        x = h ^ k;
+        x += 0x9e3779b97f4a7c15;
+        x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9;
+        x = (x ^ (x >> 27))*0x94d049bb133111eb;
+        h = x ^ (x >> 31);
+    }
+    return h;
+}
+
+int Score_table::find(const Interval_info &interval, uint64_t h) {
+    int mask = (int) slots.size() - 1;
+    int s = (int) (h & mask);
+    while (slots[s] >= 0) {
+        int e = slots[s];
+        if (live[e] and hashes[e] == h and entries[e].first == interval) {
+            return s;
+        }
+        s = (s + 1) & mask;
+    }
+    return s;
+}
+
+void Score_table::rebuild() {
+    // drops the dead entries without changing the order of the others
+    int k = 0;
+    for (int e = 0; e < entries.size(); e++) {
+        if (live[e]) {
+            if (k != e) {
+                entries[k] = std::move(entries[e]);
+                hashes[k] = hashes[e];
+            }
+            k += 1;
+        }
+    }
+    entries.resize(k);
+    hashes.resize(k);
+    live.assign(k, true);
+    int num_slots = 16;
+    while (num_slots < 4*(k + 1)) {
+        num_slots *= 2;
+    }
+    slots.assign(num_slots, -1);
+    for (int e = 0; e < k; e++) {
+        int mask = num_slots - 1;
+        int s = (int) (hashes[e] & mask);
+        while (slots[s] >= 0) {
+            s = (s + 1) & mask;
+        }
+        slots[s] = e;
+    }
+}
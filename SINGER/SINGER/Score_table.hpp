@@ -0,0 +1,65 @@
+//
+//  Score_table.hpp
+//  SINGER
+//
+
+#ifndef Score_table_hpp
+#define Score_table_hpp
+
+#include <stdio.h>
+#include <cstring>
+#include "Interval.hpp"
+
+// scores of intervals in an open-addressing hash table keyed by the branch nodes, the bounds and the seed
+// the entries are iterated in the order they were inserted, so the iteration does not depend on the node addresses
+class Score_table {
+
+public:
+
+    vector<pair<Interval_info, double>> entries = {}; // in insertion order, erased entries stay until the next rebuild
+    vector<bool> live = {};
+
+    class iterator {
+
+    public:
+
+        Score_table *table = nullptr;
+        int e = 0;
+
+        iterator(Score_table *t, int i);
+
+        pair<Interval_info, double> &operator*();
+
+        iterator &operator++();
+
+        bool operator!=(const iterator &other) const;
+    };
+
+    Score_table();
+
+    int size();
+
+    void clear();
+
+    double &operator[](const Interval_info &interval); // inserts a score of 0 when the interval is absent
+
+    void erase(const Interval_info &interval);
+
+    iterator begin();
+
+    iterator end();
+
+private:
+
+    vector<int> slots = {}; // entry of each slot, -1 when empty
+    vector<uint64_t> hashes = {}; // hash of each entry
+    int num_live = 0;
+
+    uint64_t get_hash(const Interval_info &interval);
+
+    int find(const Interval_info &interval, uint64_t h); // the slot of the interval, or the empty slot ending its probe
+
+    void rebuild();
+};
+
+#endif /* Score_table_hpp */
@@ -40,6 +40,37 @@ void TSP::reserve_memory(int length) {
     rhos.reserve(length);
 }
 
+void TSP::reset(size_t max_bytes) {
+    // back to a new TSP, but the rows of forward_probs are kept (at most max_bytes of them) to be overwritten
+    for (auto &x : state_spaces) {
+        for (Interval *interval : x.second) {
+            delete interval;
+        }
+    }
+    vector<vector<double>> rows = move(forward_probs);
+    size_t kept_rows = 0;
+    size_t kept_bytes = 0;
+    while (kept_rows < rows.size() and kept_bytes + sizeof(double)*rows[kept_rows].capacity() <= max_bytes) {
+        kept_bytes += sizeof(double)*rows[kept_rows].capacity();
+        kept_rows += 1;
+    }
+    if (kept_rows < rows.size()) {
+        rows.resize(kept_rows);
+        rows.shrink_to_fit();
+    }
+    *this = TSP();
+    forward_probs = move(rows);
+}
+
+void TSP::add_row(const vector<double> &row) {
+    if (num_rows < forward_probs.size()) {
+        forward_probs[num_rows].assign(row.begin(), row.end());
+    } else {
+        forward_probs.push_back(row);
+    }
+    num_rows += 1;
+}
+
 void TSP::start(Branch &branch, double t) {
     cut_time = t;
     curr_index = 0;
@@ -52,7 +83,7 @@ void TSP::start(Branch &branch, double t) {
         temp[i] = exp(-curr_intervals[i]->lb) - exp(-curr_intervals[i]->ub);
     }
     state_spaces[0] = curr_intervals;
-    forward_probs.emplace_back(temp);
+    add_row(temp);
     temp.clear();
 }
 
@@ -98,7 +129,7 @@ void TSP::transfer(Recombination &r, Branch &prev_branch, Branch &next_branch) {
         generate_intervals(next_branch, lb, ub);
     }
     state_spaces[curr_index] = curr_intervals;
-    forward_probs.emplace_back(temp);
+    add_row(temp);
     temp.clear();
     set_dimensions();
     compute_factors();
@@ -116,7 +147,7 @@ void TSP::recombine(Branch &prev_branch, Branch &next_branch) {
     curr_index += 1;
     lower_bound = max(cut_time, next_branch.lower_node->time);
     generate_intervals(next_branch, next_branch.lower_node->time, next_branch.upper_node->time);
-    forward_probs.emplace_back(temp);
+    add_row(temp);
     state_spaces[curr_index] = curr_intervals;
     set_dimensions();
     compute_factors();
@@ -195,7 +226,7 @@ void TSP::forward(double rho) {
     compute_upper_sums();
     curr_index += 1;
     prev_rho = rho;
-    forward_probs.emplace_back(lower_sums);
+    add_row(lower_sums);
     for (int i = 0; i < dim; i++) {
         assert(forward_probs[curr_index][i] >= 0);
         forward_probs[curr_index][i] += diagonals[i]*forward_probs[curr_index-1][i] + lower_diagonals[i]*upper_sums[i];
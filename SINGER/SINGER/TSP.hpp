@@ -38,6 +38,10 @@ public:
     
     void reserve_memory(int length);
     
+    void reset(size_t max_bytes);
+    
+    void add_row(const vector<double> &row);
+    
     void start(Branch &branch, double t);
     
     void set_interval_constraint(Recombination &r);
@@ -87,6 +91,7 @@ public:
     int sample_index = -1;
     vector<double> trace_back_probs = {};
     vector<vector<double>> forward_probs = {};
+    int num_rows = 0; // rows of forward_probs in use, the others are kept from earlier runs
     vector<double> emissions = vector<double>(4);
     
     double recomb_cdf(double s, double t);
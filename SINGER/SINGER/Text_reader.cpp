@@ -0,0 +1,77 @@
+//
+//  Text_reader.cpp
+//  SINGER
+//
+
+#include "Text_reader.hpp"
+
+Text_reader::Text_reader() {}
+
+Text_reader::Text_reader(const char *first, const char *last) {
+    p = first;
+    this->last = last;
+}
+
+bool Text_reader::open(string filename) {
+    ifstream fin(filename, ios::in|ios::binary|ios::ate);
+    if (!fin.good()) {
+        return false;
+    }
+    size_t size = fin.tellg();
+    fin.seekg(0);
+    buffer.resize(size);
+    fin.read(buffer.data(), size);
+    p = buffer.data();
+    last = p + size;
+    return true;
+}
+
+bool Text_reader::read(double &x) {
+    if (!skip_space()) {
+        return false;
+    }
+    auto [ptr, ec] = from_chars(p, last, x);
+    if (ec != errc()) {
+        return false;
+    }
+    p = ptr;
+    return true;
+}
+
+bool Text_reader::read(int &x) {
+    if (!skip_space()) {
+        return false;
+    }
+    auto [ptr, ec] = from_chars(p, last, x);
+    if (ec != errc()) {
+        return false;
+    }
+    p = ptr;
+    return true;
+}
+
+vector<Text_reader> Text_reader::split(int num_chunks) {
+    vector<Text_reader> chunks = {};
+    size_t chunk_size = (last - p)/max(num_chunks, 1) + 1;
+    const char *first = p;
+    while (first < last) {
+        const char *cut = first + min(chunk_size, (size_t) (last - first));
+        const char *line_end = cut < last ? (const char *) memchr(cut, '\n', last - cut) : nullptr;
+        cut = line_end == nullptr ? last : line_end + 1;
+        chunks.push_back(Text_reader(first, cut));
+        first = cut;
+    }
+    return chunks;
+}
+
+// private methods:
+
+bool Text_reader::skip_space() {
+    while (p < last and (*p == ' ' or *p == '\n' or *p == '\t' or *p == '\r')) {
+        p++;
+    }
+    if (p < last and *p == '+') { // accepted by ifstream >>, not by from_chars
+        p++;
+    }
+    return p < last;
+}
@@ -0,0 +1,41 @@
+//
+//  Text_reader.hpp
+//  SINGER
+//
+
+#ifndef Text_reader_hpp
+#define Text_reader_hpp
+
+#include <stdio.h>
+#include <cstring>
+#include <charconv>
+#include "Node.hpp"
+
+// whitespace separated numbers from a file read in one block, parsed with from_chars instead of ifstream >>
+class Text_reader {
+
+public:
+
+    const char *p = nullptr;
+    const char *last = nullptr;
+
+    Text_reader();
+
+    Text_reader(const char *first, const char *last); // a view into text owned by another reader
+
+    bool open(string filename);
+
+    bool read(double &x);
+
+    bool read(int &x);
+
+    vector<Text_reader> split(int num_chunks); // views of the remaining text, cut at line breaks
+
+private:
+
+    vector<char> buffer = {};
+
+    bool skip_space();
+};
+
+#endif /* Text_reader_hpp */
@@ -15,6 +15,16 @@ Threader_smc::Threader_smc(double c, double q) {
 Threader_smc::~Threader_smc() {
 }
 
+void Threader_smc::reset() {
+    // ready for the next rethread with the same settings, without giving back the memory of the HMMs
+    pruner = Trace_pruner();
+    bsp.reset(max_memory);
+    fbsp.reset(max_memory);
+    tsp.reset(max_memory);
+    new_joining_branches.clear();
+    added_branches.clear();
+}
+
 void Threader_smc::thread(ARG &a, Node_ptr n) {
     cout << "Iteration: " << a.sample_nodes.size() << endl;
     cut_time = 0;
@@ -80,7 +90,8 @@ void Threader_smc::internal_rethread(ARG &a, tuple<double, Branch, double> cut_p
     double ar = acceptance_ratio(a);
     // cout << "Acceptance ratio: " << ar << endl;
     double q = random();
-    if (q < ar) {
+    accepted = q < ar;
+    if (accepted) {
         a.add(new_joining_branches, added_branches);
     } else {
         a.add(a.joining_branches, a.removed_branches);
@@ -121,7 +132,8 @@ void Threader_smc::fast_internal_rethread(ARG &a, tuple<double, Branch, double>
     sample_joining_points(a);
     double ar = acceptance_ratio(a);
     double q = random();
-    if (q < ar) {
+    accepted = q < ar;
+    if (accepted) {
         a.add(new_joining_branches, added_branches);
     } else {
         a.add(a.joining_branches, a.removed_branches);
@@ -213,13 +225,14 @@ void Threader_smc::run_fast_BSP(ARG &a) {
     fbsp.reserve_memory(end_index - start_index);
     fbsp.set_cutoff(cutoff);
     fbsp.set_emission(pe);
-    set<Interval_info> start_intervals = pruner.insertions.begin()->second;
-    fbsp.start(a.start_tree, start_intervals, cut_time);
+    auto change_it = pruner.state_changes.begin();
+    fbsp.start(a.start_tree, change_it->insertions, cut_time);
     auto recomb_it = a.recombinations.upper_bound(start);
     auto mut_it = a.mutation_sites.lower_bound(start);
     auto query_it = a.removed_branches.begin();
-    auto delete_it = pruner.deletions.upper_bound(start);
-    auto insert_it = pruner.insertions.upper_bound(start);
+    while (change_it != pruner.state_changes.end() and change_it->pos <= start) {
+        change_it++;
+    }
     vector<double> mutations;
     set<double> mut_set = {};
     Node_ptr query_node = nullptr;
@@ -228,10 +241,9 @@ void Threader_smc::run_fast_BSP(ARG &a) {
             query_node = query_it->second.lower_node;
             query_it++;
         }
-        while (delete_it->first <= a.coordinates[i]) {
-            fbsp.update_states(delete_it->second, insert_it->second);
-            delete_it++;
-            insert_it++;
+        while (change_it != pruner.state_changes.end() and change_it->pos <= a.coordinates[i]) {
+            fbsp.update_states(change_it->deletions, change_it->insertions);
+            change_it++;
         }
         if (a.coordinates[i] == recomb_it->first) {
             Recombination &r = recomb_it->second;
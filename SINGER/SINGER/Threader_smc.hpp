@@ -35,6 +35,8 @@ public:
     
     ~Threader_smc();
     
+    void reset();
+    
     void thread(ARG &a, Node_ptr n);
     
     void internal_rethread(ARG &a, tuple<double, Branch, double> cut_point);
@@ -54,6 +56,7 @@ public:
     double end = 0;
     int start_index = 0;
     int end_index = 0;
+    bool accepted = true; // whether the last internal rethread kept the new threading
     Trace_pruner pruner = Trace_pruner();
     approx_BSP bsp = approx_BSP();
     fast_BSP fbsp = fast_BSP();
@@ -64,6 +67,7 @@ public:
     shared_ptr<Polar_emission> pe = make_shared<Polar_emission>();
     map<double, Branch> new_joining_branches = {};
     map<double, Branch> added_branches = {};
+    size_t max_memory = 256 << 20; // bytes of forward probabilities kept by reset() in each HMM
     
     void get_boundary(ARG &a);
     
@@ -18,10 +18,7 @@ void Trace_pruner::prune_arg(ARG &a) {
     end = a.removed_branches.rbegin()->first;
     segments.insert({start, end});
     used_seeds = {start, end};
-    seed_trees[start] = a.start_tree;
-    seed_trees[start].internal_cut(cut_time);
-    deletions[end] = {};
-    insertions[end] = {};
+    seed_trees[start] = Persistent_tree(a.start_tree, cut_time);
     build_match_map(a);
     double x = 0;
     while (potential_seeds.size() > 2 or segments.size() > 0) {
@@ -29,6 +26,7 @@ void Trace_pruner::prune_arg(ARG &a) {
         extend(a, x);
     }
     assert(segments.size() == 0);
+    sort_events();
 }
 
 void Trace_pruner::set_check_points(set<double> &p) {
@@ -45,25 +43,28 @@ void Trace_pruner::start_search(ARG &a, double m) {
     seed_trees[m] = a.internal_modify_tree_to(m, seed_trees[x0], x0);
     length += abs(m - x0);
     double min_mismatch = INT_MAX;
-    for (auto &x : seed_trees[m].parents) {
-        if (x.second->time > cut_time) {
-            mismatch = count_mismatch(Branch(x.first, x.second), n, m);
-            min_mismatch = min(mismatch, min_mismatch);
-        }
-    }
-    for (auto &x : seed_trees[m].parents) {
-        if (x.second->time > cut_time) {
-            Branch b = Branch(x.first, x.second);
-            mismatch = count_mismatch(b, n, m);
+    vector<Branch> best_branches = {};
+    int k = site_index(m);
+    double s0 = get_state(n, m, k);
+    for (const Branch &b : seed_trees[m].get_branches()) {
+        if (b.upper_node->time > cut_time) {
+            mismatch = count_mismatch(b, s0, m, k);
+            if (mismatch < min_mismatch) {
+                min_mismatch = mismatch;
+                best_branches.clear();
+            }
             if (mismatch == min_mismatch) {
-                lb = max(cut_time, b.lower_node->time);
-                ub = b.upper_node->time;
-                interval = Interval_info(b, lb, ub);
-                interval.seed_pos = m;
-                seed_scores[interval] = 1;
+                best_branches.push_back(b);
             }
         }
     }
+    for (const Branch &b : best_branches) {
+        lb = max(cut_time, b.lower_node->time);
+        ub = b.upper_node->time;
+        interval = Interval_info(b, lb, ub);
+        interval.seed_pos = m;
+        seed_scores[interval] = 1;
+    }
     restrict_search();
     potential_seeds.erase(m);
     assert(seed_scores.size() > 0 and seed_scores.size() <= band_width);
@@ -138,23 +139,21 @@ double Trace_pruner::min_reduction_error() {
 
 void Trace_pruner::write_reductions(ARG &a) {
     assert(segments.size() == 0);
-    auto delete_it = deletions.begin();
-    auto insert_it = insertions.begin();
+    auto change_it = state_changes.begin();
     int start_index = a.get_index(start);
     int end_index = a.get_index(end);
     set<Interval_info> reduced_set = {};
     bool state_change = false;
     for (int i = start_index; i < end_index; i++) {
-        while (delete_it->first <= a.coordinates[i]) {
-            for (auto x : delete_it->second) {
+        while (change_it != state_changes.end() and change_it->pos <= a.coordinates[i]) {
+            for (auto x : change_it->deletions) {
                 assert(reduced_set.count(x) > 0);
                 reduced_set.erase(x);
             }
-            for (auto x : insert_it->second) {
+            for (auto x : change_it->insertions) {
                 reduced_set.insert(x);
             }
-            delete_it++;
-            insert_it++;
+            change_it++;
             state_change = true;
         }
         if (state_change) {
@@ -174,9 +173,13 @@ Node_ptr Trace_pruner::get_node_at(double x) {
 }
 
 double Trace_pruner::count_mismatch(Branch branch, Node_ptr n, double m) {
-    double s0 = n->get_state(m);
-    double sl = branch.lower_node->get_state(m);
-    double su = branch.upper_node->get_state(m);
+    int k = site_index(m);
+    return count_mismatch(branch, get_state(n, m, k), m, k);
+}
+
+double Trace_pruner::count_mismatch(const Branch &branch, double s0, double m, int k) {
+    double sl = get_state(branch.lower_node, m, k);
+    double su = get_state(branch.upper_node, m, k);
     if (branch.upper_node->index != -1) {
         if (abs(sl - s0) > 0.5 and abs(su - s0) > 0.5) {
             return 1;
@@ -194,6 +197,54 @@ double Trace_pruner::count_mismatch(Branch branch, Node_ptr n, double m) {
     }
 }
 
+void Trace_pruner::index_sites(ARG &a) {
+    site_ids.clear();
+    genotypes.clear();
+    auto mb_it = a.mutation_branches.lower_bound(start);
+    int k = 0;
+    while (mb_it->first <= end) {
+        site_ids[mb_it->first] = k;
+        k += 1;
+        mb_it++;
+    }
+}
+
+const vector<uint64_t> &Trace_pruner::get_genotype(Node_ptr n) {
+    auto it = genotypes.find(n);
+    if (it != genotypes.end()) {
+        return it->second;
+    }
+    vector<uint64_t> &genotype = genotypes[n];
+    genotype.resize((site_ids.size() + 63)/64, 0);
+    auto mut_it = n->mutation_sites.lower_bound(start);
+    while (mut_it->first <= end) {
+        auto site_it = site_ids.find(mut_it->first);
+        if (mut_it->second != 0 and site_it != site_ids.end()) {
+            int k = site_it->second;
+            genotype[k >> 6] |= uint64_t(1) << (k & 63);
+        }
+        mut_it++;
+    }
+    return genotype;
+}
+
+int Trace_pruner::site_index(double m) {
+    auto site_it = site_ids.find(m);
+    if (site_it == site_ids.end()) {
+        return -1;
+    }
+    return site_it->second;
+}
+
+double Trace_pruner::get_state(Node_ptr n, double m, int k) {
+    // the node maps are only walked once per node, later states are single bit tests
+    if (k < 0) {
+        return n->get_state(m);
+    }
+    const vector<uint64_t> &genotype = get_genotype(n);
+    return (genotype[k >> 6] >> (k & 63)) & 1;
+}
+
 /*
 double Trace_pruner::count_mismatch(Branch branch, Node_ptr n, double m) {
     if (private_mutations.count(m) > 0) {
@@ -224,6 +275,7 @@ void Trace_pruner::build_match_map(ARG &a) {
     double m = 0;
     double inf = INT_MAX;
     double lb = 0;
+    index_sites(a);
     auto mb_it = a.mutation_branches.lower_bound(start);
     Node_ptr n = nullptr;
     while (mb_it->first < end) {
@@ -391,8 +443,10 @@ void Trace_pruner::mutation_update(Node_ptr n, double m) {
     }
     double mismatch = 0;
     double penalty = 0;
+    int k = site_index(m);
+    double s0 = get_state(n, m, k);
     for (auto &[i, s] : curr_scores) {
-        mismatch = count_mismatch(i.branch, n, m);
+        mismatch = count_mismatch(i.branch, s0, m, k);
         penalty = pow(mut_prob, mismatch);
         s *= penalty;
     }
@@ -402,18 +456,16 @@ void Trace_pruner::recombination_forward(Recombination &r) {
     transition_scores.clear();
     for (auto &[i, s] : curr_scores) {
         forward_transition(r, i);
-        assert(!r.affect(i.branch) or deletions[r.pos].count(i) > 0);
     }
-    curr_scores = transition_scores;
+    swap(curr_scores, transition_scores);
 }
 
 void Trace_pruner::recombination_backward(Recombination &r) {
     transition_scores.clear();
     for (auto &[i, s] : curr_scores) {
         backward_transition(r, i);
-        assert(!r.affect(i.branch) or insertions[r.pos].count(i) > 0);
     }
-    curr_scores = transition_scores;
+    swap(curr_scores, transition_scores);
 }
 
 void Trace_pruner::forward_transition(Recombination &r, const Interval_info &interval) {
@@ -421,6 +473,7 @@ void Trace_pruner::forward_transition(Recombination &r, const Interval_info &int
     double w0, w1, w2;
     Interval_info new_interval;
     Branch b;
+    size_t num_events = deletions.size();
     double p = curr_scores[interval];
     p = max(p, cutoff*0.1f);
     double l = interval.lb;
@@ -468,7 +521,7 @@ void Trace_pruner::forward_transition(Recombination &r, const Interval_info &int
         new_interval = Interval_info(r.merging_branch, l, u);
         forward_transition_helper(interval, new_interval, r.pos, p);
     }
-    assert(!r.affect(interval.branch) or deletions[r.pos].count(interval) > 0);
+    assert(!r.affect(interval.branch) or deletions.size() > num_events); // the interval left the state space at r.pos
 }
 
 void Trace_pruner::backward_transition(Recombination &r, const Interval_info &interval) {
@@ -476,6 +529,7 @@ void Trace_pruner::backward_transition(Recombination &r, const Interval_info &in
     double w0, w1, w2;
     Interval_info new_interval;
     Branch b;
+    size_t num_events = insertions.size();
     double p = curr_scores[interval];
     p = max(p, cutoff*0.1f);
     double l = interval.lb;
@@ -528,7 +582,7 @@ void Trace_pruner::backward_transition(Recombination &r, const Interval_info &in
         new_interval = Interval_info(r.target_branch, l, u);
         backward_transition_helper(interval, new_interval, r.pos, p);
     }
-    assert(!r.affect(interval.branch) or insertions[r.pos].count(interval) > 0);
+    assert(!r.affect(interval.branch) or insertions.size() > num_events); // the interval entered the state space at r.pos
 }
 
 void Trace_pruner::forward_transition_helper(Interval_info prev_interval, Interval_info next_interval, double x, double p) {
@@ -538,8 +592,8 @@ void Trace_pruner::forward_transition_helper(Interval_info prev_interval, Interv
     assert(prev_interval.lb >= cut_time and next_interval.lb >= cut_time);
     next_interval.seed_pos = prev_interval.seed_pos;
     transition_scores[next_interval] += p;
-    deletions[x].insert(prev_interval);
-    insertions[x].insert(next_interval);
+    deletions.push_back({x, prev_interval});
+    insertions.push_back({x, next_interval});
 }
 
 void Trace_pruner::backward_transition_helper(Interval_info next_interval, Interval_info prev_interval, double x, double p) {
@@ -549,47 +603,65 @@ void Trace_pruner::backward_transition_helper(Interval_info next_interval, Inter
     assert(prev_interval.lb >= cut_time and next_interval.lb >= cut_time);
     prev_interval.seed_pos = next_interval.seed_pos;
     transition_scores[prev_interval] += p;
-    deletions[x].insert(prev_interval);
-    insertions[x].insert(next_interval);
+    deletions.push_back({x, prev_interval});
+    insertions.push_back({x, next_interval});
 }
 
-void Trace_pruner::forward_prune_states(double x) {
-    auto it = curr_scores.begin();
-    while (it != curr_scores.end()) {
-        if (it->second < cutoff) {
-            deletions[x].insert(it->first);
-            it = curr_scores.erase(it);
-            insertions[x];
+void Trace_pruner::sort_events() {
+    // the same interval can be recorded by several seeds, so duplicates are dropped like in a set
+    sort(deletions.begin(), deletions.end());
+    deletions.erase(unique(deletions.begin(), deletions.end()), deletions.end());
+    sort(insertions.begin(), insertions.end());
+    insertions.erase(unique(insertions.begin(), insertions.end()), insertions.end());
+    state_changes.clear();
+    auto delete_it = deletions.begin();
+    auto insert_it = insertions.begin();
+    while (delete_it != deletions.end() or insert_it != insertions.end()) {
+        State_change change = State_change();
+        if (insert_it == insertions.end() or (delete_it != deletions.end() and delete_it->first < insert_it->first)) {
+            change.pos = delete_it->first;
         } else {
-            ++it;
+            change.pos = insert_it->first;
+        }
+        while (delete_it != deletions.end() and delete_it->first == change.pos) {
+            change.deletions.push_back(delete_it->second);
+            delete_it++;
+        }
+        while (insert_it != insertions.end() and insert_it->first == change.pos) {
+            change.insertions.push_back(insert_it->second);
+            insert_it++;
+        }
+        state_changes.push_back(change);
+    }
+}
+
+void Trace_pruner::forward_prune_states(double x) {
+    for (auto &[i, s] : curr_scores) {
+        if (s < cutoff) {
+            deletions.push_back({x, i});
+            curr_scores.erase(i);
         }
     }
 }
 
 void Trace_pruner::backward_prune_states(double x) {
-    auto it = curr_scores.begin();
-    while (it != curr_scores.end()) {
-        if (it->second < cutoff) {
-            insertions[x].insert(it->first);
-            it = curr_scores.erase(it);
-            deletions[x];
-        } else {
-            ++it;
+    for (auto &[i, s] : curr_scores) {
+        if (s < cutoff) {
+            insertions.push_back({x, i});
+            curr_scores.erase(i);
         }
     }
 }
 
 void Trace_pruner::delete_all(double x) {
     for (auto &[i, s] : curr_scores) {
-        deletions[x].insert(i);
-        insertions[x];
+        deletions.push_back({x, i});
     }
 }
 
 void Trace_pruner::insert_all(double x) {
     for (auto &[i, s] : curr_scores) {
-        insertions[x].insert(i);
-        deletions[x];
+        insertions.push_back({x, i});
     }
 }
 
@@ -692,7 +764,7 @@ void Trace_pruner::remove_segment(double x, double y) {
 }
 
 double Trace_pruner::get_match_time(set<Branch> &branches, double m, Node_ptr n) {
-    double state = n->get_state(m);
+    double state = get_state(n, m, site_index(m));
     assert(state == 0 or state == 1);
     int valid_count = 0;
     for (const Branch &b : branches) {
@@ -757,6 +829,7 @@ void Trace_pruner::restrict_search() {
     vector<Interval_info> seeds;
     transform(seed_scores.begin(), seed_scores.end(), back_inserter(seeds),
                        [](const auto& pair) { return pair.first; });
+    sort(seeds.begin(), seeds.end()); // the table keeps the insertion order, the shuffle starts from a fixed order
     // Shuffle using existing random_engine
     shuffle(seeds.begin(), seeds.end(), random_engine);
 
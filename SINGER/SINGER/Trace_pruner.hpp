@@ -12,8 +12,17 @@
 #include <algorithm>
 #include "Pruner.hpp"
 #include "Interval.hpp"
+#include "Score_table.hpp"
 #include "ARG.hpp"
 
+// the intervals leaving and entering the reduced state space at one position
+struct State_change {
+
+    double pos = 0;
+    vector<Interval_info> deletions = {};
+    vector<Interval_info> insertions = {};
+};
+
 class Trace_pruner : public Pruner {
     
 public:
@@ -31,26 +40,30 @@ public:
     map<double, Branch> queries = {};
     set<double> private_mutations = {};
     
-    map<double, Tree> seed_trees = {};
+    map<double, Persistent_tree> seed_trees = {}; // versions sharing their unchanged branches
     
     map<double, double> match_map = {};
     map<double, double> potential_seeds = {};
     set<double> used_seeds = {};
     
     map<Branch, double> seed_match = {};
-    map<Interval_info, double> seed_scores = {};
-    map<Interval_info, double> curr_scores = {};
+    Score_table seed_scores = Score_table();
+    Score_table curr_scores = Score_table();
     
     set<double> check_points;
     
     map<double, set<Branch>> reductions = {};
-    map<double, set<Interval_info>> deletions = {};
-    map<double, set<Interval_info>> insertions = {};
+    vector<pair<double, Interval_info>> deletions = {}; // recorded while extending, sorted once at the end
+    vector<pair<double, Interval_info>> insertions = {};
+    vector<State_change> state_changes = {}; // the sorted events grouped by position
     
-    map<Interval_info, double> transition_scores = {};
+    Score_table transition_scores = Score_table();
     
     set<pair<double, double>> segments = {};
     
+    unordered_map<double, int> site_ids = {}; // bit of each site in [start, end] in the packed genotypes
+    unordered_map<Node_ptr, vector<uint64_t>> genotypes = {}; // derived states of a node at these sites, filled on first use
+    
     Trace_pruner();
     
     void prune_arg(ARG &a);
@@ -91,6 +104,18 @@ public:
     
     double count_mismatch(Branch branch, Node_ptr n, double m);
     
+    double count_mismatch(const Branch &branch, double s0, double m, int k);
+    
+    void index_sites(ARG &a);
+    
+    const vector<uint64_t> &get_genotype(Node_ptr n);
+    
+    int site_index(double m);
+    
+    double get_state(Node_ptr n, double m, int k);
+    
+    void sort_events();
+    
     void forward_prune_states(double x);
     
     void backward_prune_states(double x);
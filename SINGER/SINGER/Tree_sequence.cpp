@@ -0,0 +1,229 @@
+//
+//  Tree_sequence.cpp
+//  SINGER
+//
+
+#include "Tree_sequence.hpp"
+#include "ARG.hpp"
+
+Tree_sequence::Tree_sequence() {}
+
+void Tree_sequence::add_block(ARG &a, double offset) {
+    start_block();
+    // same indexing as ARG::write_nodes
+    a.create_node_set();
+    int index = 0;
+    for (Node_ptr n : a.node_set) {
+        if (n->time > 0) {
+            n->set_index(index);
+        }
+        add_block_node(n->time*a.Ne);
+        index += 1;
+    }
+    a.node_set.clear();
+    finish_block_nodes();
+    for (auto [k1, k2, x, l] : a.get_edges()) {
+        if (k1 >= 0) {
+            add_block_edge(x + offset, l + offset, (int) k1, (int) k2);
+        }
+    }
+    for (auto &x : a.mutation_branches) {
+        double m = x.first;
+        if (m >= a.sequence_length or m <= 0) {
+            continue;
+        }
+        for (auto &y : x.second) {
+            add_block_mutation(m + offset, y.lower_node->index, y.lower_node->get_state(m) == 1 ? 1 : 0);
+        }
+    }
+    sequence_length = max(sequence_length, offset + a.sequence_length);
+}
+
+void Tree_sequence::add_block(string node_file, string branch_file, string mutation_file, double offset) {
+    Text_reader node_fin = Text_reader();
+    Text_reader branch_fin = Text_reader();
+    Text_reader mutation_fin = Text_reader();
+    if (!node_fin.open(node_file) or !branch_fin.open(branch_file) or !mutation_fin.open(mutation_file)) {
+        cerr << "input file not found: " << node_file << endl;
+        exit(1);
+    }
+    start_block();
+    double t;
+    while (node_fin.read(t)) {
+        add_block_node(t);
+    }
+    finish_block_nodes();
+    double x, y, p, c;
+    double length = 0;
+    while (branch_fin.read(x) and branch_fin.read(y) and branch_fin.read(p) and branch_fin.read(c)) {
+        length = max(length, y);
+        if (p >= 0) {
+            add_block_edge(x + offset, y + offset, (int) p, (int) c);
+        }
+    }
+    double m, lower, upper, state;
+    while (mutation_fin.read(m) and mutation_fin.read(lower) and mutation_fin.read(upper) and mutation_fin.read(state)) {
+        if (m < length) {
+            add_block_mutation(m + offset, (int) lower, (int) state);
+        }
+    }
+    sequence_length = max(sequence_length, offset + length);
+}
+
+void Tree_sequence::dump(string filename) {
+    Kastore store = Kastore();
+    int num_nodes = (int) node_times.size();
+    int num_edges = (int) edge_left.size();
+    // edges sorted by parent time as tskit requires
+    vector<int32_t> edge_order(num_edges);
+    iota(edge_order.begin(), edge_order.end(), 0);
+    sort(edge_order.begin(), edge_order.end(), [&](int32_t i, int32_t j) {
+        return make_tuple(node_times[edge_parent[i]], edge_parent[i], edge_child[i], edge_left[i]) < make_tuple(node_times[edge_parent[j]], edge_parent[j], edge_child[j], edge_left[j]);
+    });
+    vector<double> sorted_left(num_edges), sorted_right(num_edges);
+    vector<int32_t> sorted_parent(num_edges), sorted_child(num_edges);
+    for (int i = 0; i < num_edges; i++) {
+        int k = edge_order[i];
+        sorted_left[i] = edge_left[k];
+        sorted_right[i] = edge_right[k];
+        sorted_parent[i] = edge_parent[k];
+        sorted_child[i] = edge_child[k];
+    }
+    edge_order.clear();
+    vector<int32_t> insertion_order(num_edges), removal_order(num_edges);
+    iota(insertion_order.begin(), insertion_order.end(), 0);
+    iota(removal_order.begin(), removal_order.end(), 0);
+    sort(insertion_order.begin(), insertion_order.end(), [&](int32_t i, int32_t j) {
+        return make_tuple(sorted_left[i], node_times[sorted_parent[i]], sorted_parent[i], sorted_child[i]) < make_tuple(sorted_left[j], node_times[sorted_parent[j]], sorted_parent[j], sorted_child[j]);
+    });
+    sort(removal_order.begin(), removal_order.end(), [&](int32_t i, int32_t j) {
+        return make_tuple(sorted_right[i], -node_times[sorted_parent[i]], -sorted_parent[i], -sorted_child[i]) < make_tuple(sorted_right[j], -node_times[sorted_parent[j]], -sorted_parent[j], -sorted_child[j]);
+    });
+    // sites and mutations are added in order of position
+    int num_sites = (int) site_positions.size();
+    int num_mutations = (int) mutation_nodes.size();
+    vector<uint32_t> unit_offsets(max(num_sites, num_mutations) + 1);
+    iota(unit_offsets.begin(), unit_offsets.end(), 0);
+    auto put_empty_column = [&](string key, int num_rows) {
+        store.put(key, Kastore::INT8, vector<char>());
+        store.put(key + "_offset", Kastore::UINT32, vector<uint32_t>(num_rows + 1, 0));
+    };
+    store.put_string("format/name", "tskit.trees");
+    store.put("format/version", Kastore::UINT32, vector<uint32_t>({12, 7}));
+    store.put("sequence_length", Kastore::FLOAT64, vector<double>({sequence_length}));
+    store.put_string("time_units", "generations");
+    store.put_string("metadata", "");
+    store.put_string("metadata_schema", "");
+    random_device rd;
+    ostringstream uuid;
+    for (int i = 0; i < 16; i++) {
+        if (i == 4 or i == 6 or i == 8 or i == 10) {
+            uuid << "-";
+        }
+        uuid << hex << setw(2) << setfill('0') << (rd() & 0xff);
+    }
+    store.put_string("uuid", uuid.str());
+    store.put("nodes/flags", Kastore::UINT32, node_flags);
+    store.put("nodes/time", Kastore::FLOAT64, node_times);
+    store.put("nodes/population", Kastore::INT32, vector<int32_t>(num_nodes, -1));
+    store.put("nodes/individual", Kastore::INT32, vector<int32_t>(num_nodes, -1));
+    put_empty_column("nodes/metadata", num_nodes);
+    store.put_string("nodes/metadata_schema", "");
+    store.put("edges/left", Kastore::FLOAT64, sorted_left);
+    store.put("edges/right", Kastore::FLOAT64, sorted_right);
+    store.put("edges/parent", Kastore::INT32, sorted_parent);
+    store.put("edges/child", Kastore::INT32, sorted_child);
+    put_empty_column("edges/metadata", num_edges);
+    store.put_string("edges/metadata_schema", "");
+    store.put("sites/position", Kastore::FLOAT64, site_positions);
+    store.put("sites/ancestral_state", Kastore::INT8, vector<char>(num_sites, '0'));
+    store.put("sites/ancestral_state_offset", Kastore::UINT32, vector<uint32_t>(unit_offsets.begin(), unit_offsets.begin() + num_sites + 1));
+    put_empty_column("sites/metadata", num_sites);
+    store.put_string("sites/metadata_schema", "");
+    store.put("mutations/site", Kastore::INT32, mutation_sites);
+    store.put("mutations/node", Kastore::INT32, mutation_nodes);
+    store.put("mutations/parent", Kastore::INT32, vector<int32_t>(num_mutations, -1));
+    store.put("mutations/derived_state", Kastore::INT8, derived_states);
+    store.put("mutations/derived_state_offset", Kastore::UINT32, vector<uint32_t>(unit_offsets.begin(), unit_offsets.begin() + num_mutations + 1));
+    put_empty_column("mutations/metadata", num_mutations);
+    store.put_string("mutations/metadata_schema", "");
+    store.put("migrations/left", Kastore::FLOAT64, vector<double>());
+    store.put("migrations/right", Kastore::FLOAT64, vector<double>());
+    store.put("migrations/node", Kastore::INT32, vector<int32_t>());
+    store.put("migrations/source", Kastore::INT32, vector<int32_t>());
+    store.put("migrations/dest", Kastore::INT32, vector<int32_t>());
+    store.put("migrations/time", Kastore::FLOAT64, vector<double>());
+    put_empty_column("migrations/metadata", 0);
+    store.put_string("migrations/metadata_schema", "");
+    store.put("individuals/flags", Kastore::UINT32, vector<uint32_t>());
+    store.put("individuals/location", Kastore::FLOAT64, vector<double>());
+    store.put("individuals/location_offset", Kastore::UINT32, vector<uint32_t>(1, 0));
+    store.put("individuals/parents", Kastore::INT32, vector<int32_t>());
+    store.put("individuals/parents_offset", Kastore::UINT32, vector<uint32_t>(1, 0));
+    put_empty_column("individuals/metadata", 0);
+    store.put_string("individuals/metadata_schema", "");
+    put_empty_column("populations/metadata", 0);
+    store.put_string("populations/metadata_schema", "");
+    put_empty_column("provenances/timestamp", 0);
+    put_empty_column("provenances/record", 0);
+    store.put("indexes/edge_insertion_order", Kastore::INT32, insertion_order);
+    store.put("indexes/edge_removal_order", Kastore::INT32, removal_order);
+    store.dump(filename);
+}
+
+// private methods:
+
+void Tree_sequence::start_block() {
+    block_nodes.clear();
+    block_samples = 0;
+    block_time = -1;
+    num_blocks += 1;
+}
+
+void Tree_sequence::add_block_node(double t) {
+    if (t == 0) {
+        // samples are shared by all blocks, and only added by the first one
+        if (num_blocks == 1) {
+            sample_ids.push_back((int32_t) node_times.size());
+            node_flags.push_back(1);
+            node_times.push_back(0);
+        }
+        if (block_samples >= sample_ids.size()) {
+            cerr << "number of samples differs between blocks" << endl;
+            exit(1);
+        }
+        block_nodes.push_back(sample_ids[block_samples]);
+        block_samples += 1;
+    } else {
+        t = max(block_time + time_gap, t);
+        block_nodes.push_back((int32_t) node_times.size());
+        node_flags.push_back(0);
+        node_times.push_back(t);
+        block_time = t;
+    }
+}
+
+void Tree_sequence::finish_block_nodes() {
+    if (num_blocks == 1) {
+        num_samples = block_samples;
+    } else if (block_samples != num_samples) {
+        cerr << "number of samples differs between blocks" << endl;
+        exit(1);
+    }
+}
+
+void Tree_sequence::add_block_edge(double left, double right, int parent, int child) {
+    edge_left.push_back(left);
+    edge_right.push_back(right);
+    edge_parent.push_back(block_nodes[parent]);
+    edge_child.push_back(block_nodes[child]);
+}
+
+void Tree_sequence::add_block_mutation(double pos, int node, int state) {
+    if (site_positions.size() == 0 or site_positions.back() != pos) {
+        site_positions.push_back(pos);
+    }
+    mutation_sites.push_back((int32_t) site_positions.size() - 1);
+    mutation_nodes.push_back(block_nodes[node]);
+    derived_states.push_back(state == 1 ? '1' : '0');
+}
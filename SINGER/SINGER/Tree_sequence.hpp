@@ -0,0 +1,67 @@
+//
+//  Tree_sequence.hpp
+//  SINGER
+//
+
+#ifndef Tree_sequence_hpp
+#define Tree_sequence_hpp
+
+#include <stdio.h>
+#include <fstream>
+#include <random>
+#include <numeric>
+#include <iomanip>
+#include <sstream>
+#include "Kastore.hpp"
+#include "Text_reader.hpp"
+
+class ARG;
+
+// tskit tables built block by block, so a long ARG can be assembled without keeping the block ARGs around
+class Tree_sequence {
+
+public:
+
+    double sequence_length = 0;
+    double time_gap = 1e-4; // minimal spacing between the times of consecutive non-sample nodes in a block
+    int num_samples = 0;
+    int num_blocks = 0;
+
+    vector<uint32_t> node_flags = {};
+    vector<double> node_times = {};
+    vector<double> edge_left = {};
+    vector<double> edge_right = {};
+    vector<int32_t> edge_parent = {};
+    vector<int32_t> edge_child = {};
+    vector<double> site_positions = {};
+    vector<int32_t> mutation_sites = {};
+    vector<int32_t> mutation_nodes = {};
+    vector<char> derived_states = {};
+
+    Tree_sequence();
+
+    void add_block(ARG &a, double offset);
+
+    void add_block(string node_file, string branch_file, string mutation_file, double offset);
+
+    void dump(string filename);
+
+private:
+
+    vector<int32_t> sample_ids = {};
+    vector<int32_t> block_nodes = {};
+    int block_samples = 0;
+    double block_time = -1;
+
+    void start_block();
+
+    void add_block_node(double t);
+
+    void finish_block_nodes();
+
+    void add_block_edge(double left, double right, int parent, int child);
+
+    void add_block_mutation(double pos, int node, int state);
+};
+
+#endif /* Tree_sequence_hpp */
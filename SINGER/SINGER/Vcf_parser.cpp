@@ -0,0 +1,194 @@
+//
+//  Vcf_parser.cpp
+//  SINGER
+//
+
+#include "Vcf_parser.hpp"
+
+Vcf_parser::Vcf_parser() {}
+
+Vcf_parser::~Vcf_parser() {
+    if (mapped_size > 0) {
+        munmap((void *) data, mapped_size);
+    }
+}
+
+bool Vcf_parser::open(string filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    size = st.st_size;
+    if (size > 0) {
+        void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        madvise(p, size, MADV_SEQUENTIAL);
+        data = (const char *) p;
+        mapped_size = size;
+    }
+    ::close(fd);
+    size_t offset = 0;
+    while (offset < size and data[offset] == '#') {
+        size_t line_end = next_line(offset);
+        read_header_line(data + offset, data + line_end);
+        offset = line_end;
+    }
+    body_start = offset;
+    return true;
+}
+
+void Vcf_parser::read_header_line(const char *first, const char *last) {
+    if (last - first >= 6 and memcmp(first, "#CHROM", 6) == 0) {
+        int num_fields = 1 + (int) count(first, last, '\t');
+        num_haplotypes = 2*(num_fields - 9);
+    }
+}
+
+size_t Vcf_parser::next_line(size_t offset) {
+    if (offset >= size) {
+        return size;
+    }
+    const char *p = (const char *) memchr(data + offset, '\n', size - offset);
+    return p == nullptr ? size : p - data + 1;
+}
+
+int Vcf_parser::read_position(size_t offset) {
+    const char *line_end = data + next_line(offset);
+    int pos = -1;
+    from_chars(skip_field(data + offset, line_end), line_end, pos);
+    return pos;
+}
+
+size_t Vcf_parser::find_position(double x, size_t begin) {
+    // binary search for the first record at or after x, records are sorted by position
+    size_t lo = begin;
+    size_t hi = size;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo)/2;
+        size_t m = (mid == 0 or data[mid - 1] == '\n') ? mid : next_line(mid);
+        if (m >= hi) {
+            while (lo < hi and read_position(lo) < x) {
+                lo = next_line(lo);
+            }
+            return lo;
+        }
+        if (read_position(m) < x) {
+            lo = next_line(m);
+        } else {
+            hi = m;
+        }
+    }
+    return lo;
+}
+
+size_t Vcf_parser::parse_record(size_t offset, Record &record) {
+    size_t next = next_line(offset);
+    parse_line(data + offset, data + next, record);
+    return next;
+}
+
+void Vcf_parser::parse_line(const char *first, const char *last, Record &record) {
+    if (last > first and last[-1] == '\n') {
+        last -= 1;
+    }
+    if (last > first and last[-1] == '\r') {
+        last -= 1;
+    }
+    const char *fields[10];
+    fields[0] = first;
+    for (int i = 1; i < 10; i++) {
+        fields[i] = skip_field(fields[i - 1], last);
+    }
+    record.pos = -1;
+    from_chars(fields[1], last, record.pos);
+    size_t ref_length = fields[4] - fields[3] - 1;
+    size_t alt_length = fields[5] - fields[4] - 1;
+    record.snp = ref_length <= 1 and alt_length <= 1;
+    record.carriers.clear();
+    record.num_haplotypes = 0;
+    if (record.snp) {
+        bool gt_only = fields[9] - fields[8] == 3 and memcmp(fields[8], "GT", 2) == 0;
+        parse_genotypes(fields[9], last, gt_only, record);
+    }
+}
+
+vector<Vcf_parser::Record> Vcf_parser::parse(size_t begin, size_t end, int num_threads) {
+    int num_chunks = max(1, min(num_threads, (int) ((end - begin) >> 20) + 1));
+    vector<size_t> cuts = {begin};
+    for (int k = 1; k < num_chunks; k++) {
+        size_t cut = begin + (end - begin)/num_chunks*k;
+        cut = (cut == 0 or data[cut - 1] == '\n') ? cut : next_line(cut);
+        cuts.push_back(min(max(cut, cuts.back()), end));
+    }
+    cuts.push_back(end);
+    vector<vector<Record>> chunk_records(num_chunks);
+    auto parse_chunk = [&](int k) {
+        size_t offset = cuts[k];
+        while (offset < cuts[k + 1]) {
+            chunk_records[k].emplace_back();
+            offset = parse_record(offset, chunk_records[k].back());
+        }
+    };
+    vector<thread> workers = {};
+    for (int k = 1; k < num_chunks; k++) {
+        workers.emplace_back(parse_chunk, k);
+    }
+    parse_chunk(0);
+    for (thread &t : workers) {
+        t.join();
+    }
+    vector<Record> records = move(chunk_records[0]);
+    for (int k = 1; k < num_chunks; k++) {
+        move(chunk_records[k].begin(), chunk_records[k].end(), back_inserter(records));
+    }
+    return records;
+}
+
+// private methods:
+
+const char *Vcf_parser::skip_field(const char *p, const char *last) {
+    if (p >= last) {
+        return last;
+    }
+    const char *q = (const char *) memchr(p, '\t', last - p);
+    return q == nullptr ? last : q + 1;
+}
+
+void Vcf_parser::parse_genotypes(const char *first, const char *last, bool gt_only, Record &record) {
+    int num_individuals = num_haplotypes/2;
+    if (gt_only and num_individuals > 0 and last - first == 4*num_individuals - 1) {
+        // fixed-width "a|b" columns: only look at the bytes equal to '1'
+        const char *p = first;
+        while ((p = (const char *) memchr(p, '1', last - p)) != nullptr) {
+            size_t k = p - first;
+            if (k % 4 == 0) {
+                record.carriers.push_back((int) (k/4*2));
+            } else if (k % 4 == 2) {
+                record.carriers.push_back((int) (k/4*2 + 1));
+            }
+            p += 1;
+        }
+        record.num_haplotypes = num_haplotypes;
+        return;
+    }
+    int individual_index = 0;
+    const char *p = first;
+    while (p < last) {
+        const char *q = (const char *) memchr(p, '\t', last - p);
+        q = q == nullptr ? last : q;
+        if (q - p >= 1 and p[0] == '1') {
+            record.carriers.push_back(2*individual_index);
+        }
+        if (q - p >= 3 and p[2] == '1') {
+            record.carriers.push_back(2*individual_index + 1);
+        }
+        individual_index += 1;
+        p = q + 1;
+    }
+    record.num_haplotypes = 2*individual_index;
+}
@@ -0,0 +1,65 @@
+//
+//  Vcf_parser.hpp
+//  SINGER
+//
+
+#ifndef Vcf_parser_hpp
+#define Vcf_parser_hpp
+
+#include <stdio.h>
+#include <cstring>
+#include <charconv>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Node.hpp"
+
+// scans a memory-mapped plain .vcf in place, offsets are byte offsets of line starts
+class Vcf_parser {
+
+public:
+
+    struct Record {
+        int pos = -1;
+        bool snp = false; // single base ref and alt
+        int num_haplotypes = 0;
+        vector<int> carriers = {}; // haplotypes with allele 1
+    };
+
+    const char *data = nullptr;
+    size_t size = 0;
+    size_t body_start = 0;
+    int num_haplotypes = 0;
+
+    Vcf_parser();
+
+    ~Vcf_parser();
+
+    bool open(string filename);
+
+    void read_header_line(const char *first, const char *last);
+
+    size_t next_line(size_t offset);
+
+    int read_position(size_t offset);
+
+    size_t find_position(double x, size_t begin);
+
+    size_t parse_record(size_t offset, Record &record);
+
+    void parse_line(const char *first, const char *last, Record &record);
+
+    vector<Record> parse(size_t begin, size_t end, int num_threads);
+
+private:
+
+    size_t mapped_size = 0;
+
+    const char *skip_field(const char *p, const char *last);
+
+    void parse_genotypes(const char *first, const char *last, bool gt_only, Record &record);
+};
+
+#endif /* Vcf_parser_hpp */
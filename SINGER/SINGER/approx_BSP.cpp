@@ -20,6 +20,32 @@ void approx_BSP::reserve_memory(int length) {
     forward_probs.reserve(length);
 }
 
+void approx_BSP::reset(size_t max_bytes) {
+    // back to a new approx_BSP, but the rows of forward_probs are kept (at most max_bytes of them) to be overwritten
+    vector<vector<double>> rows = move(forward_probs);
+    size_t kept_rows = 0;
+    size_t kept_bytes = 0;
+    while (kept_rows < rows.size() and kept_bytes + sizeof(double)*rows[kept_rows].capacity() <= max_bytes) {
+        kept_bytes += sizeof(double)*rows[kept_rows].capacity();
+        kept_rows += 1;
+    }
+    if (kept_rows < rows.size()) {
+        rows.resize(kept_rows);
+        rows.shrink_to_fit();
+    }
+    *this = approx_BSP();
+    forward_probs = move(rows);
+}
+
+void approx_BSP::add_row(const vector<double> &row) {
+    if (num_rows < forward_probs.size()) {
+        forward_probs[num_rows].assign(row.begin(), row.end());
+    } else {
+        forward_probs.push_back(row);
+    }
+    num_rows += 1;
+}
+
 void approx_BSP::start(set<Branch> &branches, double t) {
     cut_time = t;
     curr_index = 0;
@@ -46,7 +72,7 @@ void approx_BSP::start(set<Branch> &branches, double t) {
         }
     }
     cutoff = min(0.01, cutoff/curr_intervals.size()); // adjust cutoff based on number of states;
-    forward_probs.push_back(temp);
+    add_row(temp);
     weight_sums.push_back(0.0);
     set_dimensions();
     compute_interval_info();
@@ -80,7 +106,7 @@ void approx_BSP::start(Tree &tree, double t) {
         }
     }
     cutoff = min(0.01, cutoff/curr_intervals.size()); // adjust cutoff based on number of states;
-    forward_probs.push_back(temp);
+    add_row(temp);
     weight_sums.push_back(0.0);
     set_dimensions();
     compute_interval_info();
@@ -107,7 +133,7 @@ void approx_BSP::forward(double rho) {
     prev_rho = rho;
     curr_index += 1;
     recomb_sum = inner_product(recomb_probs.begin(), recomb_probs.end(), forward_probs[curr_index - 1].begin(), 0.0);
-    forward_probs.push_back(recomb_probs);
+    add_row(recomb_probs);
     for (int i = 0; i < dim; i++) {
         forward_probs[curr_index][i] = forward_probs[curr_index - 1][i]*(1 - recomb_probs[i]) + recomb_sum*recomb_weights[i];
     }
@@ -392,7 +418,7 @@ void approx_BSP::generate_intervals(Recombination &r) {
             }
         }
     }
-    forward_probs.push_back(temp);
+    add_row(temp);
     curr_intervals = move(temp_intervals);
 }
 
@@ -74,6 +74,7 @@ public:
     int sample_index = -1;
     vector<double> trace_back_probs = {};
     vector<vector<double>> forward_probs = {};
+    int num_rows = 0; // rows of forward_probs in use, the others are kept from earlier runs
     
     // states after pruning:
     bool states_change = false;
@@ -85,6 +86,10 @@ public:
     
     void reserve_memory(int length);
     
+    void reset(size_t max_bytes);
+    
+    void add_row(const vector<double> &row);
+    
     void start(set<Branch> &branches, double t);
     
     void start(Tree &tree, double t);
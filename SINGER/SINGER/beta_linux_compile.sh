@@ -17,10 +17,10 @@ VERSION_DIR="$RELEASE_DIR/singer-$VERSION-beta-linux-x86_64"
 mkdir -p $VERSION_DIR
 
 # Compile the program with optimizations and debugging information
-g++ -std=c++17 -O3 -g -static *.cpp -o $VERSION_DIR/singer
+g++ -std=c++17 -O3 -g -static *.cpp -lz -pthread -o $VERSION_DIR/singer
 
 # Compile the debug version of the program
-g++ -std=c++17 -g -static *.cpp -o $VERSION_DIR/singer_debug
+g++ -std=c++17 -g -static *.cpp -lz -pthread -o $VERSION_DIR/singer_debug
 
 # Copy additional files
 cp singer_master $VERSION_DIR/singer_master
@@ -18,10 +18,36 @@ void fast_BSP::reserve_memory(int length) {
     forward_probs.reserve(length);
 }
 
-void fast_BSP::start(set<Branch> &start_branches, set<Interval_info> &start_intervals, double t) {
+void fast_BSP::reset(size_t max_bytes) {
+    // back to a new fast_BSP, but the rows of forward_probs are kept (at most max_bytes of them) to be overwritten
+    vector<vector<double>> rows = move(forward_probs);
+    size_t kept_rows = 0;
+    size_t kept_bytes = 0;
+    while (kept_rows < rows.size() and kept_bytes + sizeof(double)*rows[kept_rows].capacity() <= max_bytes) {
+        kept_bytes += sizeof(double)*rows[kept_rows].capacity();
+        kept_rows += 1;
+    }
+    if (kept_rows < rows.size()) {
+        rows.resize(kept_rows);
+        rows.shrink_to_fit();
+    }
+    *this = fast_BSP();
+    forward_probs = move(rows);
+}
+
+void fast_BSP::add_row(const vector<double> &row) {
+    if (num_rows < forward_probs.size()) {
+        forward_probs[num_rows].assign(row.begin(), row.end());
+    } else {
+        forward_probs.push_back(row);
+    }
+    num_rows += 1;
+}
+
+void fast_BSP::start(set<Branch> &start_branches, vector<Interval_info> &start_intervals, double t) {
     cut_time = t;
     curr_index = 0;
-    set<Interval_info> empty_set = {};
+    vector<Interval_info> empty_set = {};
     update_states(empty_set, start_intervals);
     double lb = 0;
     double ub = 0;
@@ -39,7 +65,7 @@ void fast_BSP::start(set<Branch> &start_branches, set<Interval_info> &start_inte
             temp_probs.emplace_back(p);
         }
     }
-    forward_probs.emplace_back(temp_probs);
+    add_row(temp_probs);
     reduced_sums.emplace_back(0.0);
     set_dimensions();
     compute_interval_info();
@@ -47,10 +73,10 @@ void fast_BSP::start(set<Branch> &start_branches, set<Interval_info> &start_inte
     temp_probs.clear();
 }
 
-void fast_BSP::start(Tree &start_tree, set<Interval_info> &start_intervals, double t) {
+void fast_BSP::start(Tree &start_tree, vector<Interval_info> &start_intervals, double t) {
     cut_time = t;
     curr_index = 0;
-    set<Interval_info> empty_set = {};
+    vector<Interval_info> empty_set = {};
     update_states(empty_set, start_intervals);
     double lb = 0;
     double ub = 0;
@@ -68,7 +94,7 @@ void fast_BSP::start(Tree &start_tree, set<Interval_info> &start_intervals, doub
             temp_probs.emplace_back(p);
         }
     }
-    forward_probs.emplace_back(temp_probs);
+    add_row(temp_probs);
     reduced_sums.emplace_back(0.0);
     set_dimensions();
     compute_interval_info();
@@ -124,7 +150,7 @@ void fast_BSP::regular_forward(double rho) {
     prev_rho = rho;
     curr_index += 1;
     recomb_sum = inner_product(recomb_probs.begin(), recomb_probs.end(), forward_probs[curr_index - 1].begin(), 0.0);
-    forward_probs.emplace_back(recomb_probs);
+    add_row(recomb_probs);
     for (int i = 0; i < dim; i++) {
         forward_probs[curr_index][i] = forward_probs[curr_index - 1][i]*(1 - recomb_probs[i]) + recomb_sum*join_weights[i];
     }
@@ -164,7 +190,7 @@ void fast_BSP::update(double rho) {
             temp_probs.emplace_back(0);
         }
     }
-    forward_probs.emplace_back(temp_probs);
+    add_row(temp_probs);
     curr_intervals = temp_intervals;
     state_spaces[curr_index] = curr_intervals;
     set_dimensions();
@@ -288,7 +314,7 @@ bool fast_BSP::intercept(Interval_info &ii) {
 }
  */
 
-void fast_BSP::update_states(set<Interval_info> &deletions, set<Interval_info> &insertions) {
+void fast_BSP::update_states(vector<Interval_info> &deletions, vector<Interval_info> &insertions) {
     for (const Interval_info &ii : deletions) {
         const Branch &b = ii.branch;
         set<Interval_info> &intervals = reduced_intervals[b];
@@ -481,7 +507,7 @@ void fast_BSP::generate_intervals(Recombination &r) {
             temp_probs.emplace_back(0);
         }
     }
-    forward_probs.emplace_back(temp_probs);
+    add_row(temp_probs);
     curr_intervals = temp_intervals;
     set_dimensions();
     cc->update(r);
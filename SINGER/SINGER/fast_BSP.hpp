@@ -67,6 +67,7 @@ public:
     int sample_index = -1;
     vector<double> trace_back_probs = {};
     vector<vector<double>> forward_probs = {};
+    int num_rows = 0; // rows of forward_probs in use, the others are kept from earlier runs
     
     // states after pruning:
     bool branch_change = false;
@@ -81,9 +82,13 @@ public:
     
     void reserve_memory(int length);
     
-    void start(set<Branch> &start_branches, set<Interval_info> &start_intervals, double t);
+    void reset(size_t max_bytes);
     
-    void start(Tree &start_tree, set<Interval_info> &start_intervals, double t);
+    void add_row(const vector<double> &row);
+    
+    void start(set<Branch> &start_branches, vector<Interval_info> &start_intervals, double t);
+    
+    void start(Tree &start_tree, vector<Interval_info> &start_intervals, double t);
     
     void set_cutoff(double x);
     
@@ -107,7 +112,7 @@ public:
     
     map<double, Branch> sample_joining_branches(int start_index, vector<double> &coordinates);
     
-    void update_states(set<Interval_info> &deletions, set<Interval_info> &insertions);
+    void update_states(vector<Interval_info> &deletions, vector<Interval_info> &insertions);
     
     void set_dimensions();
     
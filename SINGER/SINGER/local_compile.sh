@@ -1,5 +1,5 @@
 #!/bin/bash
 
-g++ -std=c++17 -O3 -g -static *.cpp -o singer
-g++ -std=c++17 -g -static *.cpp -o singer_debug
+g++ -std=c++17 -O3 -g -static *.cpp -lz -pthread -o singer
+g++ -std=c++17 -g -static *.cpp -lz -pthread -o singer_debug
 
@@ -12,9 +12,31 @@ int main(int argc, const char * argv[]) {
     bool fast = false;
     bool resume = false;
     bool debug = false;
+    bool tskit_output = false;
+    bool stitch = false;
+    bool prepare = false;
+    bool archive = false;
+    int extract_index = -1;
+    bool coalescence = false;
+    bool coalescence_output = false;
+    int focal = -1;
+    double coalescence_window = 10000;
+    bool mutation_ages = false;
+    bool diversity = false;
+    bool coalescence_summary = false;
+    bool sample_output = true;
+    bool diagnostics = false;
+    double target_ess = 0;
+    bool adaptive = false;
+    double focus_start = -1, focus_end = -1;
+    string chain_prefixes = "";
+    string ordering = "input";
+    string saved_prefix = "";
     double r = -1, m = -1, Ne = -1;
     int num_iters = 0;
     int spacing = 1;
+    int freq = 1;
+    int num_threads = 1;
     double start_pos = -1, end_pos = -1;
     string input_filename = "", output_prefix = "";
     string recomb_map_filename = "", mut_map_filename = "";
@@ -22,6 +44,7 @@ int main(int argc, const char * argv[]) {
     double polar = 0.5;
     double epsilon_hmm = 0.1;
     double epsilon_psmc = 0.05;
+    double hmm_memory = 256;
     int seed = 42;
     for (int i = 1; i < argc; ++i) {
         string arg = argv[i];
@@ -46,6 +69,133 @@ int main(int argc, const char * argv[]) {
             }
             debug = true;
         }
+        else if (arg == "-trees") {
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                cerr << "Error: -trees flag doesn't take any value. " << endl;
+                exit(1);
+            }
+            tskit_output = true;
+        }
+        else if (arg == "-stitch") {
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                cerr << "Error: -stitch flag doesn't take any value. " << endl;
+                exit(1);
+            }
+            stitch = true;
+        }
+        else if (arg == "-prepare") {
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                cerr << "Error: -prepare flag doesn't take any value. " << endl;
+                exit(1);
+            }
+            prepare = true;
+        }
+        else if (arg == "-archive") {
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                cerr << "Error: -archive flag doesn't take any value. " << endl;
+                exit(1);
+            }
+            archive = true;
+        }
+        else if (arg == "-coalescence") {
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                cerr << "Error: -coalescence flag doesn't take any value. " << endl;
+                exit(1);
+            }
+            coalescence = true;
+        }
+        else if (arg == "-all_pairs") {
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                cerr << "Error: -all_pairs flag doesn't take any value. " << endl;
+                exit(1);
+            }
+            coalescence_output = true;
+            focal = -1;
+        }
+        else if (arg == "-mutation_ages") {
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                cerr << "Error: -mutation_ages flag doesn't take any value. " << endl;
+                exit(1);
+            }
+            mutation_ages = true;
+        }
+        else if (arg == "-diversity") {
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                cerr << "Error: -diversity flag doesn't take any value. " << endl;
+                exit(1);
+            }
+            diversity = true;
+        }
+        else if (arg == "-coal_summary") {
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                cerr << "Error: -coal_summary flag doesn't take any value. " << endl;
+                exit(1);
+            }
+            coalescence_summary = true;
+        }
+        else if (arg == "-no_samples") {
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                cerr << "Error: -no_samples flag doesn't take any value. " << endl;
+                exit(1);
+            }
+            sample_output = false;
+        }
+        else if (arg == "-diagnostics") {
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                cerr << "Error: -diagnostics flag doesn't take any value. " << endl;
+                exit(1);
+            }
+            diagnostics = true;
+        }
+        else if (arg == "-adaptive") {
+            if (i + 1 < argc && argv[i+1][0] != '-') {
+                cerr << "Error: -adaptive flag doesn't take any value. " << endl;
+                exit(1);
+            }
+            adaptive = true;
+        }
+        else if (arg == "-focus") {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
+                cerr << "Error: -focus flag cannot be empty. " << endl;
+                exit(1);
+            }
+            string focus = argv[++i];
+            size_t colon = focus.find(':');
+            try {
+                if (colon == string::npos) {
+                    throw invalid_argument(focus);
+                }
+                focus_start = stod(focus.substr(0, colon));
+                focus_end = stod(focus.substr(colon + 1));
+            } catch (const invalid_argument&) {
+                cerr << "Error: -focus flag expects start:end. " << endl;
+                exit(1);
+            } catch (const out_of_range&) {
+                cerr << "Error: -focus flag is out of range. " << endl;
+                exit(1);
+            }
+        }
+        else if (arg == "-target_ess") {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
+                cerr << "Error: -target_ess flag cannot be empty. " << endl;
+                exit(1);
+            }
+            try {
+                target_ess = stod(argv[++i]);
+            } catch (const invalid_argument&) {
+                cerr << "Error: -target_ess flag expects a number. " << endl;
+                exit(1);
+            }
+            diagnostics = true;
+        }
+        else if (arg == "-chains") {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
+                cerr << "Error: -chains flag cannot be empty. " << endl;
+                exit(1);
+            }
+            chain_prefixes = argv[++i];
+            diagnostics = true;
+        }
         else if (arg == "-Ne") {
             if (i + 1 >= argc || argv[i+1][0] == '-') {
                 cerr << "Error: -Ne flag cannot be empty. " << endl;
@@ -107,6 +257,24 @@ int main(int argc, const char * argv[]) {
                 exit(1);
             }
         }
+        else if (arg == "-ordering") {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
+                cerr << "Error: -ordering flag cannot be empty. " << endl;
+                exit(1);
+            }
+            ordering = argv[++i];
+            if (ordering != "input" and ordering != "random" and ordering != "greedy") {
+                cerr << "Error: -ordering flag expects input, random or greedy. " << endl;
+                exit(1);
+            }
+        }
+        else if (arg == "-extend") {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
+                cerr << "Error: -extend flag cannot be empty. " << endl;
+                exit(1);
+            }
+            saved_prefix = argv[++i];
+        }
         else if (arg == "-hmm_epsilon") {
             if (i + 1 >= argc || argv[i+1][0] == '-') {
                 cerr << "Error: -hmm_epsilon flag cannot be empty. " << endl;
@@ -119,6 +287,22 @@ int main(int argc, const char * argv[]) {
                 exit(1);
             }
         }
+        else if (arg == "-hmm_memory") {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
+                cerr << "Error: -hmm_memory flag cannot be empty. " << endl;
+                exit(1);
+            }
+            try {
+                hmm_memory = stod(argv[++i]);
+            } catch (const invalid_argument&) {
+                cerr << "Error: -hmm_memory flag expects a number. " << endl;
+                exit(1);
+            }
+            if (hmm_memory < 0) {
+                cerr << "Error: -hmm_memory flag expects a non-negative number. " << endl;
+                exit(1);
+            }
+        }
         else if (arg == "-psmc_bins") {
             if (i + 1 >= argc || argv[i+1][0] == '-') {
                 cerr << "Error: -psmc_epsilon flag cannot be empty. " << endl;
@@ -156,35 +340,35 @@ int main(int argc, const char * argv[]) {
             }
         }
         else if (arg == "-input") {
-            if (i + 1 > argc || argv[i+1][0] == '-') {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
                 cerr << "Error: -input flag cannot be empty. " << endl;
                 exit(1);
             }
             input_filename = argv[++i];
         }
         else if (arg == "-output") {
-            if (i + 1 > argc || argv[i+1][0] == '-') {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
                 cerr << "Error: -output flag cannot be empty. " << endl;
                 exit(1);
             }
             output_prefix = argv[++i];
         }
         else if (arg == "-recomb_map") {
-            if (i + 1 > argc || argv[i+1][0] == '-') {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
                 cerr << "Error: -recomb_map flag cannot be empty. " << endl;
                 exit(1);
             }
             recomb_map_filename = argv[++i];
         }
         else if (arg == "-mut_map") {
-            if (i + 1 > argc || argv[i+1][0] == '-') {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
                 cerr << "Error: -mut_map flag cannot be empty. " << endl;
                 exit(1);
             }
             mut_map_filename = argv[++i];
         }
         else if (arg == "-n") {
-            if (i + 1 > argc || argv[i+1][0] == '-') {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
                 cerr << "Error: -n flag cannot be empty. " << endl;
                 exit(1);
             }
@@ -196,7 +380,7 @@ int main(int argc, const char * argv[]) {
             }
         }
         else if (arg == "-thin") {
-            if (i + 1 > argc || argv[i+1][0] == '-') {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
                 cerr << "Error: -thin flag cannot be empty. " << endl;
                 exit(1);
             }
@@ -207,6 +391,67 @@ int main(int argc, const char * argv[]) {
                 exit(1);
             }
         }
+        else if (arg == "-freq") {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
+                cerr << "Error: -freq flag cannot be empty. " << endl;
+                exit(1);
+            }
+            try {
+                freq = stoi(argv[++i]);
+            } catch (const invalid_argument&) {
+                cerr << "Error: -freq flag expects a number. " << endl;
+                exit(1);
+            }
+        }
+        else if (arg == "-threads") {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
+                cerr << "Error: -threads flag cannot be empty. " << endl;
+                exit(1);
+            }
+            try {
+                num_threads = stoi(argv[++i]);
+            } catch (const invalid_argument&) {
+                cerr << "Error: -threads flag expects a number. " << endl;
+                exit(1);
+            }
+        }
+        else if (arg == "-extract") {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
+                cerr << "Error: -extract flag cannot be empty. " << endl;
+                exit(1);
+            }
+            try {
+                extract_index = stoi(argv[++i]);
+            } catch (const invalid_argument&) {
+                cerr << "Error: -extract flag expects a number. " << endl;
+                exit(1);
+            }
+        }
+        else if (arg == "-focal") {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
+                cerr << "Error: -focal flag cannot be empty. " << endl;
+                exit(1);
+            }
+            try {
+                focal = stoi(argv[++i]);
+            } catch (const invalid_argument&) {
+                cerr << "Error: -focal flag expects a number. " << endl;
+                exit(1);
+            }
+            coalescence_output = true;
+        }
+        else if (arg == "-coal_window") {
+            if (i + 1 >= argc || argv[i+1][0] == '-') {
+                cerr << "Error: -coal_window flag cannot be empty. " << endl;
+                exit(1);
+            }
+            try {
+                coalescence_window = stod(argv[++i]);
+            } catch (const invalid_argument&) {
+                cerr << "Error: -coal_window flag expects a number. " << endl;
+                exit(1);
+            }
+        }
         else if (arg == "-seed") {
             if (i + 1 >= argc || argv[i+1][0] == '-') {
                 cerr << "Error: -seed flag cannot be empty. " << endl;
@@ -224,6 +469,103 @@ int main(int argc, const char * argv[]) {
             exit(1);
         }
     }
+    if (prepare) {
+        // filtered, bit-packed genotypes in input_prefix.sgt, used by every later run on the same input
+        if (input_filename.size() == 0) {
+            cerr << "-input flag missing or invalid value. " << endl;
+            exit(1);
+        }
+        Sampler sampler;
+        sampler.prepare_genotypes(input_filename);
+        return 0;
+    }
+    if (stitch) {
+        // block outputs of parallel_singer: prefix_i_{i+1}_*_k.txt, block starts from the vcf index
+        if (input_filename.size() == 0 or output_prefix.size() == 0 or freq < 1) {
+            cerr << "-stitch needs -input, -output and a valid -freq. " << endl;
+            exit(1);
+        }
+        ifstream index_file(input_filename + ".index");
+        if (!index_file.good()) {
+            cerr << "index file not found: " << input_filename + ".index" << endl;
+            exit(1);
+        }
+        vector<double> block_starts = {};
+        string line;
+        while (getline(index_file, line)) {
+            if (line.size() > 0) {
+                block_starts.push_back(stod(line));
+            }
+        }
+        for (int k = 0; k < num_iters; k += freq) {
+            Tree_sequence ts = Tree_sequence();
+            ts.time_gap = 1e-7;
+            for (int j = 0; j < block_starts.size(); j++) {
+                string block_prefix = output_prefix + "_" + to_string(j) + "_" + to_string(j + 1);
+                ts.add_block(block_prefix + "_nodes_" + to_string(k) + ".txt", block_prefix + "_branches_" + to_string(k) + ".txt", block_prefix + "_muts_" + to_string(k) + ".txt", block_starts[j]);
+            }
+            string ts_filename = output_prefix + "_" + to_string(k) + ".trees";
+            cout << "Save to " << ts_filename << endl;
+            ts.dump(ts_filename);
+        }
+        return 0;
+    }
+    if (extract_index >= 0) {
+        // text files of one sample from input_prefix.arga, written by -archive
+        if (input_filename.size() == 0 or output_prefix.size() == 0) {
+            cerr << "-extract needs -input and -output. " << endl;
+            exit(1);
+        }
+        ARG_archive arg_archive = ARG_archive();
+        if (!arg_archive.open(input_filename + ".arga")) {
+            cerr << "archive file not found: " << input_filename + ".arga" << endl;
+            exit(1);
+        }
+        if (!arg_archive.read_sample(extract_index)) {
+            cerr << "sample " << extract_index << " is not in the archive. " << endl;
+            exit(1);
+        }
+        string node_file = output_prefix + "_nodes_" + to_string(extract_index) + ".txt";
+        string branch_file = output_prefix + "_branches_" + to_string(extract_index) + ".txt";
+        string recomb_file = output_prefix + "_recombs_" + to_string(extract_index) + ".txt";
+        string mut_file = output_prefix + "_muts_" + to_string(extract_index) + ".txt";
+        arg_archive.write_sample(node_file, branch_file, recomb_file, mut_file);
+        if (tskit_output) {
+            Tree_sequence ts = Tree_sequence();
+            ts.add_block(node_file, branch_file, mut_file, 0);
+            ts.dump(output_prefix + "_" + to_string(extract_index) + ".trees");
+        }
+        return 0;
+    }
+    if (coalescence) {
+        // windowed coalescence times of saved samples input_prefix_{nodes,branches}_k.txt
+        if (input_filename.size() == 0 or output_prefix.size() == 0 or freq < 1 or !coalescence_output or coalescence_window <= 0) {
+            cerr << "-coalescence needs -input, -output, -focal or -all_pairs, and valid -freq and -coal_window. " << endl;
+            exit(1);
+        }
+        for (int k = 0; k < num_iters; k += freq) {
+            string node_file = input_filename + "_nodes_" + to_string(k) + ".txt";
+            string branch_file = input_filename + "_branches_" + to_string(k) + ".txt";
+            Text_reader branch_fin = Text_reader();
+            if (!branch_fin.open(branch_file)) {
+                cerr << "input file not found: " << branch_file << endl;
+                exit(1);
+            }
+            double x, y, p, c;
+            double length = 0;
+            while (branch_fin.read(x) and branch_fin.read(y) and branch_fin.read(p) and branch_fin.read(c)) {
+                length = max(length, y);
+            }
+            ARG a = ARG(1, length); // node times stay in generations
+            a.read(node_file, branch_file);
+            Coalescence_times ct = Coalescence_times(coalescence_window, focal);
+            ct.compute(a);
+            string filename = output_prefix + "_coal_" + to_string(k) + ".csv";
+            cout << "Save to " << filename << endl;
+            ct.write(filename);
+        }
+        return 0;
+    }
     if (r < 0) {
         cerr << "-r flag missing or invalid value. " << endl;
         exit(1);
@@ -252,6 +594,14 @@ int main(int argc, const char * argv[]) {
         cerr << "-thin flag is invalid. " << endl;
         exit(1);
     }
+    if (focus_end >= 0 and (focus_start < start_pos or focus_end > end_pos or focus_start >= focus_end)) {
+        cerr << "-focus flag is invalid, the region has to lie within -start and -end. " << endl;
+        exit(1);
+    }
+    if (focus_end >= 0 and adaptive) {
+        cerr << "-focus and -adaptive flags can't be used together. " << endl;
+        exit(1);
+    }
     Sampler sampler;
     if (r > 0 and m > 0) {
         sampler = Sampler(Ne, r, m);
@@ -265,10 +615,43 @@ int main(int argc, const char * argv[]) {
     sampler.penalty = penalty;
     sampler.polar = polar;
     sampler.set_precision(epsilon_hmm, epsilon_psmc);
+    sampler.hmm_memory = (size_t) (hmm_memory*(1 << 20));
     sampler.set_input_file_prefix(input_filename);
     sampler.set_output_file_prefix(output_prefix);
     sampler.fast_mode = fast;
+    sampler.tskit_output = tskit_output;
+    sampler.archive_output = archive;
+    sampler.coalescence_output = coalescence_output;
+    sampler.coalescence_focal = focal;
+    sampler.coalescence_window = coalescence_window;
+    sampler.sample_output = sample_output;
+    sampler.diagnostics_output = diagnostics;
+    sampler.target_ess = target_ess;
+    sampler.adaptive_schedule = adaptive;
+    if (focus_end >= 0) {
+        sampler.focus_start = focus_start - start_pos;
+        sampler.focus_end = focus_end - start_pos;
+    }
+    sampler.sample_ordering = ordering;
+    // output prefixes of the other chains of the same data, separated by commas
+    stringstream chains(chain_prefixes);
+    string chain = "";
+    while (getline(chains, chain, ',')) {
+        if (chain.size() > 0 and chain != output_prefix) {
+            sampler.diagnostics.other_files.push_back(chain + "_trace.txt");
+        }
+    }
+    if (mutation_ages) {
+        sampler.accumulators.push_back(make_shared<Mutation_age_accumulator>());
+    }
+    if (coalescence_summary) {
+        sampler.accumulators.push_back(make_shared<Coalescence_accumulator>(coalescence_window, focal));
+    }
+    if (diversity) {
+        sampler.accumulators.push_back(make_shared<Diversity_accumulator>());
+    }
     sampler.random_seed = seed;
+    sampler.num_threads = max(num_threads, 1);
     sampler.start = start_pos;
     sampler.end = end_pos;
     if (resume) {
@@ -281,7 +664,11 @@ int main(int argc, const char * argv[]) {
         return 0;
     }
     sampler.load_vcf(input_filename, start_pos, end_pos);
-    sampler.iterative_start();
+    if (saved_prefix.size() > 0) {
+        sampler.incremental_start(saved_prefix);
+    } else {
+        sampler.iterative_start();
+    }
     sampler.internal_sample(num_iters, spacing);
     return 0;
 }